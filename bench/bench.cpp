@@ -0,0 +1,381 @@
+/*
+ * Hot-path microbenchmarks
+ *
+ * Times the state and MCTS primitives on the checked-in position corpus.
+ * Every benchmark is calibrated to a batch of at least ~200us, warmed up and
+ * repeated; results are written as JSON (ns per operation).
+ *
+ * The value network benchmarks use random weights unless -w is given; compare
+ * them with "simulate" for the playout / network crossover.
+ *
+ * usage: bench [-c bench/positions.txt] [-r repetitions] [-f filter]
+ *              [-o result.json] [-w vnet.bin]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "AlphaBeta.h"
+#include "DarkChess.h"
+#include "MCTS.h"
+#include "Tactics.h"
+#include "ThreadPool.h"
+#include "ValueNet.h"
+
+typedef MCTS<DarkChess_State, DarkChess_Action> DarkChess_MCTS;
+typedef MCTS<DarkChess_State, DarkChess_Action, UCB1TunedSelection, RandomExpansion,
+             RandomPlayout, SquaredBackup>
+    Tuned_MCTS;
+typedef MCTS<DarkChess_State, DarkChess_Action, ThompsonSelection> Thompson_MCTS;
+typedef MCTS<DarkChess_State, DarkChess_Action, RaveSelection, RandomExpansion,
+             RandomPlayout, RaveBackup>
+    Rave_MCTS;
+
+struct Position {
+	std::string name;
+	DarkChess_State state;
+};
+
+struct Result {
+	std::string name;
+	long batch;
+	std::vector<double> samples; // ns/op
+};
+
+// 防止編譯器把量測的結果最佳化掉
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+static bool LoadCorpus(const char* path, std::vector<Position>& corpus) {
+	FILE* fp = fopen(path, "r");
+	if (fp == NULL) return false;
+
+	char line[256], name[64], side[16], board[64], cover[32];
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (line[0] == '#') continue;
+		if (sscanf(line, "%63s %15s %63s %31s", name, side, board, cover) != 4 ||
+		    strlen(board) != BOARD_SIZE || strlen(cover) != 14) {
+			continue;
+		}
+
+		FIN fins[BOARD_SIZE];
+		int covers[14];
+		for (int sq = 0; sq < BOARD_SIZE; sq++) fins[sq] = char2fin(board[sq]);
+		for (int i = 0; i < 14; i++) covers[i] = cover[i] - '0';
+
+		Position pos;
+		pos.name = name;
+		pos.state.InitBoard(fins, covers);
+		int color = strcmp(side, "red") == 0     ? RED
+		            : strcmp(side, "black") == 0 ? BLK
+		                                         : UNKNOWN;
+		if (color != UNKNOWN) {
+			int opp = (color == RED) ? BLK : RED;
+			pos.state.setCurrPlayer(opp); // 上一手的玩家
+			pos.state.setMyColor(color);
+			pos.state.setOppColor(opp);
+		}
+		corpus.push_back(pos);
+	}
+	fclose(fp);
+	return !corpus.empty();
+}
+
+template <typename F>
+static double TimeBatch(F& op, long batch, long& counter) {
+	auto start = std::chrono::steady_clock::now();
+	for (long i = 0; i < batch; i++) op(counter++);
+	return std::chrono::duration<double, std::nano>(
+	           std::chrono::steady_clock::now() - start)
+	    .count();
+}
+
+// 批次大小從 min_batch 開始倍增，使每次量測都涵蓋整個 corpus
+template <typename F>
+static Result Measure(const char* name, F op, int reps, long min_batch) {
+	Result result;
+	result.name = name;
+
+	// 校正批次大小，使每次量測至少約 200us
+	long counter = 0;
+	long batch = min_batch;
+	while (TimeBatch(op, batch, counter) < 2e5 && batch < (1L << 24)) {
+		batch *= 2;
+	}
+	result.batch = batch;
+
+	// warm-up
+	for (int i = 0; i < 3; i++) TimeBatch(op, batch, counter);
+
+	for (int i = 0; i < reps; i++) {
+		result.samples.push_back(TimeBatch(op, batch, counter) / batch);
+	}
+	std::sort(result.samples.begin(), result.samples.end());
+	return result;
+}
+
+static double Percentile(const std::vector<double>& v, double p) {
+	size_t idx = std::min(v.size() - 1, (size_t)(p * (v.size() - 1) + 0.5));
+	return v[idx];
+}
+
+int main(int argc, char* argv[]) {
+	const char* corpus_path = "bench/positions.txt";
+	const char* output = NULL;
+	const char* filter = "";
+	const char* weights = NULL;
+	int reps = 15;
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-c") == 0) {
+			corpus_path = argv[i + 1];
+		} else if (strcmp(argv[i], "-r") == 0) {
+			reps = std::max(1, atoi(argv[i + 1]));
+		} else if (strcmp(argv[i], "-f") == 0) {
+			filter = argv[i + 1];
+		} else if (strcmp(argv[i], "-o") == 0) {
+			output = argv[i + 1];
+		} else if (strcmp(argv[i], "-w") == 0) {
+			weights = argv[i + 1];
+		} else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	std::vector<Position> corpus;
+	if (!LoadCorpus(corpus_path, corpus)) {
+		fprintf(stderr, "cannot load corpus %s\n", corpus_path);
+		return 1;
+	}
+	const size_t n = corpus.size();
+	std::mt19937 rng(12345);
+
+	// 各局面的合法動作與仍有暗子的局面
+	std::vector<std::pair<size_t, DarkChess_Action>> legal;
+	std::vector<size_t> covered;
+	for (size_t p = 0; p < n; p++) {
+		for (const auto& action : corpus[p].state.getAvailableActions()) {
+			legal.push_back(std::make_pair(p, action));
+		}
+		if (corpus[p].state.getChessCount(FIN_COVER) > 0) covered.push_back(p);
+	}
+
+	// 每個局面一棵樹：根節點展開所有動作（供 bestUCT），並從根節點的第一個子節點
+	// 往下長出一條最多 CHAIN_DEPTH 層的鏈（供 backpropagate）
+	const int CHAIN_DEPTH = 32;
+	std::vector<std::unique_ptr<DarkChess_MCTS>> trees;
+	std::vector<MCTSNode<DarkChess_State, DarkChess_Action>*> leaves;
+	for (size_t p = 0; p < n; p++) {
+		const DarkChess_State& state = corpus[p].state;
+		trees.push_back(std::make_unique<DarkChess_MCTS>(state, state.getAvailableActions()));
+		auto* root = trees.back()->root;
+		for (size_t i = 0; i < root->available_actions.size(); i++) {
+			trees.back()->expand(root, rng);
+		}
+		for (auto& child : root->children) {
+			child->visits = 1 + rng() % 100;
+			child->wins = (double)(rng() % (2 * child->visits + 1)) - child->visits;
+			child->wins_sq = child->visits;
+			child->amaf_visits = child->visits * 4;
+			child->amaf_wins = child->wins * 2;
+			root->visits += child->visits;
+		}
+		// 根節點已沒有未展開的動作，鏈從第一個子節點（機會節點則為其結果）往下長
+		auto* leaf = root->children.empty() ? root : root->children[0].get();
+		if (leaf->chance) leaf = leaf->children[0].get();
+		for (int d = 0; d < CHAIN_DEPTH; d++) {
+			auto* next = trees.back()->expand(leaf, rng);
+			if (next == leaf) break; // 終局或沒有動作
+			leaf = next;
+		}
+		leaves.push_back(leaf);
+	}
+
+	std::vector<Result> results;
+	auto run = [&](const char* name, long min_batch, auto op) {
+		if (strstr(name, filter) == NULL) return;
+		fprintf(stderr, "running %s\n", name);
+		results.push_back(Measure(name, op, reps, min_batch));
+	};
+
+	run("getAvailableActions", n, [&](long i) {
+		auto actions = corpus[i % n].state.getAvailableActions();
+		DoNotOptimize(actions);
+	});
+	run("isLegalAction", n * ACTION_SIZE, [&](long i) {
+		const DarkChess_State& state = corpus[(i / ACTION_SIZE) % n].state;
+		bool legal = state.isLegalAction(
+		    DarkChess_Action(state.getCurrColor(), i % ACTION_SIZE));
+		DoNotOptimize(legal);
+	});
+	run("applyAction", legal.size(), [&](long i) {
+		const auto& entry = legal[i % legal.size()];
+		DarkChess_State next = corpus[entry.first].state.applyAction(entry.second, rng);
+		DoNotOptimize(next);
+	});
+	run("stateCopy", n, [&](long i) {
+		DarkChess_State copy(corpus[i % n].state);
+		DoNotOptimize(copy);
+	});
+	std::vector<PackedState> packed;
+	for (const auto& pos : corpus) packed.push_back(pos.state.pack());
+	run("pack", n, [&](long i) {
+		PackedState p = corpus[i % n].state.pack();
+		DoNotOptimize(p);
+	});
+	DarkChess_State unpacked; // 建構 DarkChess_State 本身的成本不計入
+	run("unpack", n, [&](long i) {
+		unpacked.unpack(packed[i % n]);
+		DoNotOptimize(unpacked);
+	});
+	run("packedHash", n, [&](long i) {
+		uint64_t h = packed[i % n].hash();
+		DoNotOptimize(h);
+	});
+	run("getHash", n, [&](long i) {
+		const DarkChess_State& state = corpus[i % n].state;
+		uint64_t h = state.getHash(state.getSideToMove());
+		DoNotOptimize(h);
+	});
+	if (!covered.empty()) {
+		run("getRandomChessId", covered.size(), [&](long i) {
+			int id = corpus[covered[i % covered.size()]].state.getRandomChessId(rng);
+			DoNotOptimize(id);
+		});
+	}
+	run("simulate", n, [&](long i) {
+		auto& tree = trees[i % n];
+		double result = tree->simulate(tree->root, rng);
+		DoNotOptimize(result);
+	});
+	HeavyPlayout heavy;
+	run("simulate/heavy", n, [&](long i) {
+		double result = heavy.simulate<DarkChess_Action>(corpus[i % n].state, rng, nullptr,
+		                                                 nullptr);
+		DoNotOptimize(result);
+	});
+	run("bestUCT", n, [&](long i) {
+		auto& tree = trees[i % n];
+		auto* best = tree->bestUCT(tree->root, rng);
+		DoNotOptimize(best);
+	});
+	run("backpropagate", n, [&](long i) {
+		trees[i % n]->backpropagate(leaves[i % n], 1.0);
+	});
+
+	// 其他選擇／回傳策略，作用在同一批樹上
+	Tuned_MCTS tuned(corpus[0].state, {});
+	Thompson_MCTS thompson(corpus[0].state, {});
+	run("bestUCT/ucb1tuned", n, [&](long i) {
+		auto* best = tuned.bestUCT(trees[i % n]->root, rng);
+		DoNotOptimize(best);
+	});
+	run("bestUCT/thompson", n, [&](long i) {
+		auto* best = thompson.bestUCT(trees[i % n]->root, rng);
+		DoNotOptimize(best);
+	});
+	run("backpropagate/squared", n, [&](long i) {
+		tuned.backpropagate(leaves[i % n], 1.0);
+	});
+	Rave_MCTS rave(corpus[0].state, {});
+	run("bestUCT/rave", n, [&](long i) {
+		auto* best = rave.bestUCT(trees[i % n]->root, rng);
+		DoNotOptimize(best);
+	});
+
+	// 展開排序的評分，每個節點第一次展開時計算一次
+	TacticalHeuristic tactics;
+	std::vector<double> scores;
+	run("tacticalScores", n, [&](long i) {
+		const auto* root = trees[i % n]->root;
+		tactics(root->state, root->available_actions, scores);
+		DoNotOptimize(scores);
+	});
+
+	// 全部翻開的局面：固定深度的 alpha-beta，每次搜尋前清空置換表
+	std::vector<size_t> revealed;
+	for (size_t p = 0; p < n; p++) {
+		if (AlphaBeta::applies(corpus[p].state)) revealed.push_back(p);
+	}
+	if (!revealed.empty()) {
+		AlphaBeta alphabeta(16);
+		alphabeta.max_depth = 6;
+		run("alphabeta/depth6", 1, [&](long i) {
+			alphabeta.clear();
+			int best = alphabeta.search(corpus[revealed[i % revealed.size()]].state);
+			DoNotOptimize(best);
+		});
+	}
+
+	// 平行區段的啟動成本：每次 genmove 進入一次
+	const int THREADS = 4;
+	ThreadPool pool(THREADS);
+	run("startup/omp", 1, [&](long) {
+		#pragma omp parallel for num_threads(THREADS)
+		for (int t = 0; t < THREADS; t++) DoNotOptimize(t);
+	});
+	run("startup/pool", 1, [&](long) {
+		pool.parallelFor(THREADS, 1, [](int, int t) {
+			DoNotOptimize(t);
+			return true;
+		});
+	});
+
+	// 價值網路：單一盤面、整個 corpus 一批、經過 ValueBatcher
+	// 靜態配置：C++14 的 new 不保證 ValueNet 需要的 32-byte 對齊
+	static ValueNet net;
+	if (weights == NULL) {
+		net.initRandom(12345);
+	} else if (!net.load(weights)) {
+		fprintf(stderr, "cannot load value network %s\n", weights);
+		return 1;
+	}
+	std::vector<const DarkChess_State*> states;
+	for (const auto& pos : corpus) states.push_back(&pos.state);
+	std::vector<float> values(n);
+	ValueBatcher batcher(net, 1, 0);
+
+	run("valuenet", n, [&](long i) {
+		float value = net.evaluate(corpus[i % n].state);
+		DoNotOptimize(value);
+	});
+	run("valuenet/batch", 1, [&](long) {
+		net.evaluate(states.data(), n, values.data());
+		DoNotOptimize(values);
+	});
+	run("valuenet/batcher", n, [&](long i) {
+		float value = batcher.evaluate(corpus[i % n].state);
+		DoNotOptimize(value);
+	});
+
+	FILE* fp = output != NULL ? fopen(output, "w") : stdout;
+	if (fp == NULL) {
+		fprintf(stderr, "cannot write %s\n", output);
+		return 1;
+	}
+	fprintf(fp, "{\n  \"corpus\": \"%s\",\n  \"positions\": %zu,\n", corpus_path, n);
+	fprintf(fp, "  \"repetitions\": %d,\n  \"benchmarks\": [\n", reps);
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result& r = results[i];
+		fprintf(fp,
+		        "    {\"name\": \"%s\", \"batch\": %ld, \"min_ns\": %.2f, "
+		        "\"p10_ns\": %.2f, \"median_ns\": %.2f, \"p90_ns\": %.2f, "
+		        "\"max_ns\": %.2f}%s\n",
+		        r.name.c_str(), r.batch, r.samples.front(), Percentile(r.samples, 0.1),
+		        Percentile(r.samples, 0.5), Percentile(r.samples, 0.9),
+		        r.samples.back(), i + 1 < results.size() ? "," : "");
+	}
+	fprintf(fp, "  ]\n}\n");
+	if (fp != stdout) fclose(fp);
+	return 0;
+}
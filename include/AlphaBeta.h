@@ -0,0 +1,117 @@
+#ifndef ALPHABETA_H
+#define ALPHABETA_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "DarkChess.h"
+#include "SharedMemory.h"
+#include "Symmetry.h"
+#include "Tablebase.h"
+#include "libchess.h"
+
+// 全部翻開後（沒有暗子，不再有機率事件）的確定性搜尋
+//
+// iterative deepening 的 negamax alpha-beta：
+// - 置換表以 Zobrist 雜湊為鍵，保存分數界限、深度與最佳走步；鍵為四個對稱方向中
+//   最小的雜湊，互為鏡像的局面共用同一個 entry，走步以標準方向保存；
+//   置換表配置在共享記憶體，之後 fork 出的行程可同時搜尋並共用 (Lazy SMP)
+// - 走步排序：置換表走步、吃子 (MVV-LVA)、每層兩個 killer、history heuristic
+// - 深度用完後做只含吃子的 quiescence search，評估為子力加上機動性
+// - 無吃翻步數達 NO_EAT_FLIP_LIMIT、長捉，或搜尋路徑上重複的局面為和局；
+//   輪到的一方沒有走步則判負
+// 分數以輪到的一方為視角。只以節點數為限時結果是確定的。
+class AlphaBeta {
+	public:
+		static const int WIN_SCORE = 30000;    // 勝：WIN_SCORE - 步數
+		static const int TB_WIN_SCORE = 20000; // 殘局庫判定的勝：TB_WIN_SCORE - 步數
+		static const int MAX_PLY = 128;
+
+		// 置換表有 2^tt_bits 個 entry（每個 16 bytes），配置失敗時只有 1 個
+		explicit AlphaBeta(int tt_bits = 20);
+
+		// 沒有暗子且已知輪到的一方時才適用
+		static bool applies(const DarkChess_State& state);
+
+		// 搜尋並回傳最佳的 action ID，沒有合法走步時回傳 -1
+		int search(const DarkChess_State& state);
+
+		// 清空置換表與走步排序的統計
+		void clear();
+
+		// 搜尋設定
+		int max_depth = 64;
+		double time_limit = 0; // 毫秒，0 表示不限
+		long node_limit = 0;   // 0 表示不限
+		const Tablebase* tablebase = nullptr;
+		int start_depth = 1;   // iterative deepening 的起始深度（輔助行程錯開深度）
+		// 不為 nullptr 時，值變為非 0 即停止搜尋（由其他行程設定）
+		const std::atomic<int>* stop_flag = nullptr;
+
+		// 上一次搜尋的統計
+		int depth = 0; // 完成的深度
+		int score = 0; // 以輪到的一方為視角
+		long nodes = 0;
+
+	private:
+		enum BOUND : uint8_t { BOUND_NONE, BOUND_UPPER, BOUND_LOWER, BOUND_EXACT };
+
+		// 置換表的內容，以一個 64-bit word 存取
+		struct Data {
+			int16_t score;
+			int16_t move; // 標準方向的 action ID，-1 為無
+			int8_t depth;
+			uint8_t bound;
+			uint16_t unused;
+		};
+		static_assert(sizeof(Data) == sizeof(uint64_t), "unexpected Data layout");
+
+		// 不加鎖：check = key ^ data，讀到其他行程寫到一半的 entry 時視為未命中
+		struct Entry {
+			std::atomic<uint64_t> check;
+			std::atomic<uint64_t> data;
+		};
+
+		struct Undo {
+			FIN captured;
+			int no_eat_flip;
+		};
+
+		SharedArray<Entry> table;
+		uint64_t table_mask;
+		int history[ACTION_SIZE];
+		int killers[MAX_PLY][2];
+
+		// 搜尋中的局面
+		FIN board[BOARD_SIZE];
+		int side;        // 輪到的一方
+		int no_eat_flip;
+		int pieces;      // 盤面上的棋子數
+		uint64_t keys[SYM_COUNT]; // 各對稱方向的雜湊，keys[SYM_IDENTITY] 為盤面本身
+		std::vector<uint64_t> hashes; // 根節點起每個局面的雜湊
+		std::vector<int> moves;       // 歷史動作的 action ID（含對局中的最後幾步）
+
+		bool stopped;
+		int root_best;
+		std::chrono::steady_clock::time_point start;
+
+		int negamax(int depth, int alpha, int beta, int ply);
+		int quiesce(int alpha, int beta, int ply);
+		int evaluate(int side_moves) const;
+
+		Undo makeMove(int action_id);
+		void unmakeMove(int action_id, const Undo& undo);
+		void toggleKeys(int from, int to, FIN piece, FIN captured);
+		bool isDraw() const;
+		bool checkStop();
+
+		bool probe(uint64_t key, Data& data) const;
+		void store(uint64_t key, const Data& data);
+
+		int orderScore(int action_id, int tt_move, int ply) const;
+};
+
+#endif
@@ -1,9 +1,12 @@
 #ifndef DARKCHESS_H
 #define DARKCHESS_H
 
+#include <stdint.h>
+
 #include <random>
 #include <vector>
 
+#include "PackedState.h"
 #include "libchess.h"
 
 class DarkChess_Action {
@@ -59,11 +62,29 @@ class DarkChess_State {
 		// 這個函數會根據 Action 對當前狀態進行更新，並返回新的狀態。
 		DarkChess_State applyAction(DarkChess_Action action);
 
+		// 同上，但翻棋結果由外部傳入的隨機數生成器決定（供每個線程使用獨立的亂數流）
+		DarkChess_State applyAction(DarkChess_Action action,
+		                            std::mt19937& rng) const;
+
 		// 返回狀態在上一步的動作（用於最後確定選擇的最佳動作）。
 		DarkChess_Action getLastAction() const { return last_action; }
 
+		// 動作的結果是否有機率性（翻棋），MCTS 以機會節點展開
+		bool isChanceAction(DarkChess_Action action) const {
+			return ActionMap[action.getActionID()].first ==
+			       ActionMap[action.getActionID()].second;
+		}
+
+		// 上一步機率事件的結果（翻出的棋子），上一步不是翻棋時為 -1
+		int getLastOutcome() const {
+			if (last_action.getActionID() < 0 || !isChanceAction(last_action)) return -1;
+			return board[ActionMap[last_action.getActionID()].second];
+		}
+
 		// 初始化盤面
 		void InitBoard();
+		// 以指定的盤面與各類暗子數量初始化
+		void InitBoard(const FIN board[BOARD_SIZE], const int cover[14]);
 
 		// 判斷是否為合法動作
 		bool isLegalAction(DarkChess_Action action) const;
@@ -75,6 +96,7 @@ class DarkChess_State {
 		bool checkCannonCanEat(DarkChess_Action action) const;
 
 		int getRandomChessId();
+		int getRandomChessId(std::mt19937& rng) const;
 
 		void applyFlip(int sq, FIN f) {
 			board[sq] = f;
@@ -98,6 +120,7 @@ class DarkChess_State {
 			chess_count[FIN_DST]--;
 			chess_count[FIN_EMPTY]++;
 			if (FIN_DST != FIN_EMPTY) no_eat_flip = 0;
+			else no_eat_flip++;
 			for (int i = 0; i < ActionMap.size(); i++) {
 				if (ActionMap[i].first == from && ActionMap[i].second == to) {
 					act_history.push_back(DarkChess_Action(curr_player, i));
@@ -123,7 +146,27 @@ class DarkChess_State {
 		// 14: 未翻開 (COVER)
 		// 15: 空格 (EMPTY)
 
+		// 局面雜湊（Zobrist）：盤面、各類暗子數量與輪到的玩家顏色
+		uint64_t getHash(int side_to_move) const;
+		// 盤面經過 symmetry（見 Symmetry.h）轉換後的雜湊
+		uint64_t getHash(int side_to_move, int symmetry) const;
+
+		// 24 bytes 的快照，unpack 不還原歷史動作與剩餘時間
+		PackedState pack() const;
+		void unpack(const PackedState& packed);
+
+		FIN getPiece(int sq) const { return board[sq]; }
+		int getCoverCount(int f) const { return coverPieceCount[f]; }
+		int getChessCount(int f) const { return chess_count[f]; }
+		int getNoEatFlip() const { return no_eat_flip; }
+		const std::vector<DarkChess_Action>& getHistory() const { return act_history; }
+
 		int getCurrColor() const { return curr_player; }
+		// curr_player 記錄上一手的玩家，實際輪到的是另一方
+		int getSideToMove() const {
+			if (curr_player == UNKNOWN) return UNKNOWN;
+			return (curr_player == RED) ? BLK : RED;
+		}
 		int getMyColor() const { return my_color; }
 		int getOppColor() const { return opp_color; }
 
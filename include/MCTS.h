@@ -3,39 +3,73 @@
 
 #include <omp.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <limits>
+#include <map>
 #include <memory>
 #include <random>
+#include <type_traits>
 #include <vector>
 
+#include "MCTSPolicy.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
 // 節點定義
+//
+// 結果有機率性的動作（State::isChanceAction，例如翻棋）展開為機會節點：
+// 機會節點的 state 為第一次抽到的結果，只用來取得動作；子節點為各種不同的結果，
+// 每次經過時重新抽樣，因此各結果被走訪的比例即為其機率
 template <typename State, typename Action>
 class MCTSNode {
 	public:
 		State state;                                     // 當前遊戲狀態
 		std::vector<Action> available_actions;           // 可用的動作
+		std::vector<Action> untried_actions;             // 尚未展開的動作
+		std::vector<double> untried_priors;              // 排序後各未展開動作的先驗
+		bool untried_ordered = false;                    // untried_actions 是否已排序
 		std::vector<std::unique_ptr<MCTSNode>> children; // 子節點
+		// 已加入 children 的數量，供不持鎖的走訪；機會節點的結果數量不定，不預留也不發布
+		std::atomic<int> child_count{0};
+		double prior = 0;                                // 展開時給的先驗分數
+		bool chance = false;                             // 機會節點：子節點為動作的各種結果
 		double wins = 0;                                 // 獲勝次數
+		double wins_sq = 0;                              // 結果平方和（SquaredBackup）
+		double amaf_wins = 0;                            // AMAF 獲勝次數（RaveBackup）
+		int amaf_visits = 0;                             // AMAF 訪問次數
 		int visits = 0;                                  // 被訪問次數
 		MCTSNode* parent = nullptr;                      // 父節點
 
 		MCTSNode(const State& state, const std::vector<Action>& actions,
 		         MCTSNode* parent = nullptr)
-		    : state(state), available_actions(actions), parent(parent) {}
+		    : state(state), available_actions(actions), parent(parent) {
+			// 終局（例如無吃翻步數已滿）仍可能有合法動作，不再展開
+			if (!state.isTerminal()) untried_actions = actions;
+			// 每個動作只展開一次，預留後 push_back 不會搬移已有的子節點。
+			// RaveBackup 不持鎖走訪 children[0, child_count)，依賴這裡的預留：
+			// 若加入的子節點超過預留量，vector 重新配置時正在走訪的線程會讀到已釋放的記憶體
+			children.reserve(untried_actions.size());
+		}
 
-		// 判斷是否為葉子節點
+		// 判斷是否為葉子節點：仍有未展開的動作或沒有子節點
 		bool isLeaf() const { 
 			bool result;
+			TRACE_LOCK_WAIT_BEGIN();
 			#pragma omp critical
 			{
-				result = children.empty();
+				TRACE_LOCK_WAIT_END();
+				result = !untried_actions.empty() || children.empty();
 			}
 			return result; 
 		}
 
-		// UCT公式
+		// UCT公式，另加上隨訪問次數遞減的先驗 prior / (1 + visits)
 		double UCT(double exploration_param = 1.41) const {
 			int local_visits;
 			#pragma omp atomic read
@@ -51,75 +85,350 @@ class MCTSNode {
         		int parent_visits;
         		#pragma omp atomic read
         		parent_visits = parent->visits;  // 使用 atomic 保護讀取 parent 的 visits
-        		return (local_wins / local_visits) + exploration_param * std::sqrt(std::log(parent_visits) / local_visits);
+        		return (local_wins / local_visits) + exploration_param * std::sqrt(std::log(parent_visits) / local_visits) +
+        		       prior / (1 + local_visits);
     		} else {
         		// 根節點的情況下，不考慮 parent->visits
         		return local_wins / local_visits;
     		}
 		}
 
-		// 隨機選擇未展開的動作
+		// 隨機取出一個未展開的動作（呼叫前需持有鎖且 untried_actions 不為空）
 		Action getRandomUntriedAction(std::mt19937& rng) {
 			std::uniform_int_distribution<> dist(0,
-			                                     available_actions.size() - 1);
-			return available_actions[dist(rng)];
+			                                     untried_actions.size() - 1);
+			int i = dist(rng);
+			Action action = untried_actions[i];
+			untried_actions[i] = untried_actions.back();
+			untried_actions.pop_back();
+			return action;
 		}
 };
 
 // MCTS
-template <typename State, typename Action>
+// 選擇、擴展、模擬、回傳四個階段由模板參數的策略決定（見 MCTSPolicy.h），
+// 預設組合即為原本的 UCT + 隨機擴展 + 隨機模擬 + 平均回傳
+template <typename State, typename Action,
+          typename Selection = UCTSelection,
+          typename Expansion = RandomExpansion,
+          typename Playout = RandomPlayout,
+          typename Backup = AverageBackup>
 class MCTS {
+	static_assert(!std::is_same<Selection, UCB1TunedSelection>::value ||
+	                  Backup::records_squares,
+	              "UCB1TunedSelection needs a Backup that records wins_sq");
+
 	public:
 		MCTSNode<State, Action>* root; // 根節點
-		double exploration_param = 1.41;
+		Selection selection;
+		Expansion expansion;
+		Playout playout;
+		Backup backup;
 		int simulation_count = 40000;
+		int thread_count = 4;
+
+		// 確定性模式：固定主種子，每個線程由 (seed, 線程編號) 衍生獨立亂數流，
+		// 各自在私有的樹上跑固定次數的模擬後依線程順序合併根節點統計，
+		// 因此結果與 OpenMP 的排程與交錯無關。
+		bool deterministic = false;
+		unsigned int seed = 0;
+
+		// 時間預算（毫秒），0 表示只以 simulation_count 為限；確定性模式下不使用
+		double time_limit = 0;
+
+		// 搜尋統計
+		int playouts = 0; // 完成的模擬次數
+		int nodes = 1;    // 樹的節點數
+
+		// 可選的確定結果查詢（例如殘局庫），命中時以該值取代展開與模擬
+		std::function<bool(const State&, double&)> exact_value;
+
+		// 可選的動作過濾（例如去除對稱的動作），套用在每個新節點的動作上；
+		// 根節點的動作由呼叫者自行處理
+		std::function<void(const State&, std::vector<Action>&)> prune_actions;
+
+		// 不為 nullptr 時改用常駐的 thread pool 執行，線程數為 pool 的大小
+		ThreadPool* pool = nullptr;
 
 		MCTS(const State& initial_state, const std::vector<Action>& actions) {
 			root = new MCTSNode<State, Action>(initial_state, actions);
 		}
 
-		~MCTS() { deleteTree(root); }
+		~MCTS() { delete root; }
+
+	private:
+		// 建立 state 的節點，動作經過 prune_actions 過濾
+		std::unique_ptr<MCTSNode<State, Action>> makeChild(const State& state,
+		                                                   MCTSNode<State, Action>* parent) {
+			std::vector<Action> actions = state.getAvailableActions();
+			if (prune_actions) prune_actions(state, actions);
+			return std::make_unique<MCTSNode<State, Action>>(state, actions, parent);
+		}
+
+		MCTSNode<State, Action>* findOutcome(MCTSNode<State, Action>* node, int outcome) {
+			MCTSNode<State, Action>* result = nullptr;
+			TRACE_LOCK_WAIT_BEGIN();
+			#pragma omp critical
+			{
+				TRACE_LOCK_WAIT_END();
+				for (const auto& child : node->children) {
+					if (child->state.getLastOutcome() == outcome) result = child.get();
+				}
+			}
+			return result;
+		}
+
+	public:
 
 		// 執行 MCTS
 		Action run(std::mt19937& rng) {
-			omp_set_num_threads(4);
+			if (deterministic) {
+				return runDeterministic();
+			}
+
+			int threads = pool != nullptr ? pool->size() : thread_count;
+
+			// 讓每個線程都使用一個新的隨機數生成器，避免 race condition
+			std::vector<std::mt19937> thread_rngs;
+			for (int t = 0; t < threads; ++t) {
+				thread_rngs.emplace_back(rng());
+			}
+
+			auto start = std::chrono::steady_clock::now();
+
+			if (pool != nullptr) {
+				// 每個 worker 約 64 個工作，閒置的 worker 從其他 worker 偷取
+				int grain = std::max(1, simulation_count / (threads * 64));
+				pool->parallelFor(simulation_count, grain, [&](int worker, int) {
+					iterate(thread_rngs[worker]);
+					#pragma omp atomic
+					playouts++;
+					return !timeUp(start);
+				});
+				return bestAction();
+			}
+
+			// 單線程時不進入 OpenMP（fork 出的子行程不使用 OpenMP 的線程）
+			if (thread_count == 1) {
+				for (int i = 0; i < simulation_count && !timeUp(start); ++i) {
+					iterate(thread_rngs[0]);
+					playouts++;
+				}
+				return bestAction();
+			}
+
+			omp_set_num_threads(thread_count);
+			bool stop = false;
 
 			#pragma omp parallel for
 			for (int i = 0; i < simulation_count; ++i) {
-				// 讓每個線程都使用一個新的隨機數生成器，避免 race condition
-            	std::mt19937 thread_rng(rng());
+				bool local_stop;
+				#pragma omp atomic read
+				local_stop = stop;
+				if (local_stop) continue;
 
-				MCTSNode<State, Action>* node = select(); // 選擇節點
-				MCTSNode<State, Action>* expanded_node =
-				    expand(node, rng);                        // 擴展
-				double result = simulate(expanded_node, rng); // 模擬
-				backpropagate(expanded_node, result);         // 回傳結果
+				std::mt19937& thread_rng = thread_rngs[omp_get_thread_num()];
+				iterate(thread_rng);
+
+				#pragma omp atomic
+				playouts++;
+				if (timeUp(start)) {
+					#pragma omp atomic write
+					stop = true;
+				}
 			}
 			// 返回擁有最多訪問次數的動作
 			return bestAction();
 		}
 
+		// 單次迭代：選擇、擴展、模擬、回傳
+		void iterate(std::mt19937& rng) {
+			MCTSNode<State, Action>* node = select(rng); // 選擇節點
+			double value;
+			// 根節點必須展開才能選出動作，不以確定結果取代
+			if (node != root && exact_value && exact_value(node->state, value)) {
+				backpropagate(node, value);
+				return;
+			}
+			MCTSNode<State, Action>* expanded_node = expand(node, rng); // 擴展
+			simulateAndBackup(expanded_node, rng,
+			                  std::integral_constant<bool, Backup::uses_trace>());
+		}
+
+		// 根節點各動作的統計：action ID -> (訪問次數, 勝利次數)
+		// 確定性模式下依線程順序合併各棵私有樹的根節點
+		std::map<int, std::pair<int, double>> rootStats() const {
+			std::map<int, std::pair<int, double>> stats;
+			if (trees.empty()) {
+				addChildStats(root, stats);
+			}
+			for (const auto& tree : trees) {
+				addChildStats(tree->root, stats);
+			}
+			return stats;
+		}
+
 	private:
+		std::vector<std::unique_ptr<MCTS>> trees; // 確定性模式的私有樹
+
+		bool timeUp(std::chrono::steady_clock::time_point start) const {
+			return time_limit > 0 &&
+			       std::chrono::duration<double, std::milli>(
+			           std::chrono::steady_clock::now() - start)
+			               .count() >= time_limit;
+		}
+
+		static void addChildStats(const MCTSNode<State, Action>* node,
+		                          std::map<int, std::pair<int, double>>& stats) {
+			for (const auto& child : node->children) {
+				auto& stat = stats[child->state.getLastAction().getActionID()];
+				stat.first += child->visits;
+				stat.second += child->wins;
+			}
+		}
+
+		// 模擬並回傳結果
+		void simulateAndBackup(MCTSNode<State, Action>* node, std::mt19937& rng,
+		                       std::false_type) {
+			double result = simulate(node, rng);
+			backpropagate(node, result);
+		}
+
+		// 需要走步紀錄的回傳策略（RAVE）：記錄模擬的動作，往上回傳時
+		// 每經過一個節點就把該節點的動作加入已出現的集合
+		void simulateAndBackup(MCTSNode<State, Action>* node, std::mt19937& rng,
+		                       std::true_type) {
+			std::vector<Action> trace;
+			double result;
+			{
+				TRACE_SCOPE(TRACE_SIMULATE);
+				result = playout.simulate(node->state, rng, exact_value, &trace);
+			}
+
+			TRACE_SCOPE(TRACE_BACKPROPAGATE);
+			ActionSet played;
+			for (const auto& action : trace) played.insert(action);
+			while (node != nullptr) {
+				backup.update(node, result, played);
+				played.insert(node->state.getLastAction());
+				node = node->parent;
+			}
+		}
+
+		// 確定性的平行搜尋 (root parallelization)
+		Action runDeterministic() {
+			trees.clear();
+			for (int t = 0; t < thread_count; ++t) {
+				trees.push_back(std::make_unique<MCTS>(root->state,
+				                                       root->available_actions));
+				trees.back()->exact_value = exact_value;
+				trees.back()->prune_actions = prune_actions;
+				trees.back()->selection = selection;
+				trees.back()->expansion = expansion;
+				trees.back()->playout = playout;
+				trees.back()->backup = backup;
+			}
+
+			// 每棵樹的亂數流只由 (seed, t) 決定，與由哪個線程執行無關
+			auto search = [this](int t) {
+				std::seed_seq seq{seed, static_cast<unsigned int>(t)};
+				std::mt19937 thread_rng(seq);
+				int count = simulation_count / thread_count +
+				            (t < simulation_count % thread_count ? 1 : 0);
+				for (int i = 0; i < count; ++i) {
+					trees[t]->iterate(thread_rng);
+				}
+			};
+			if (pool != nullptr) {
+				pool->parallelFor(thread_count, 1, [&](int, int t) {
+					search(t);
+					return true;
+				});
+			} else if (thread_count == 1) {
+				search(0);
+			} else {
+				#pragma omp parallel for schedule(static, 1) num_threads(thread_count)
+				for (int t = 0; t < thread_count; ++t) {
+					search(t);
+				}
+			}
+
+			playouts = simulation_count;
+			for (const auto& tree : trees) {
+				root->visits += tree->root->visits;
+				root->wins += tree->root->wins;
+				nodes += tree->nodes - 1;
+			}
+			std::map<int, std::pair<int, double>> merged = rootStats();
+
+			// 訪問次數相同時取 action ID 較小者
+			int best_id = -1, best_visits = -1;
+			for (const auto& entry : merged) {
+				if (entry.second.first > best_visits) {
+					best_visits = entry.second.first;
+					best_id = entry.first;
+				}
+			}
+			for (const auto& action : root->available_actions) {
+				if (action.getActionID() == best_id) return action;
+			}
+			if (root->available_actions.empty()) return Action();
+			return root->available_actions.front();
+		}
+
+	public:
+		// 以下各階段為 public，供 microbenchmark 個別量測
 		// 選擇節點 (Selection)
-		MCTSNode<State, Action>* select() {
+		MCTSNode<State, Action>* select(std::mt19937& rng) {
+			TRACE_SCOPE(TRACE_SELECT);
 			MCTSNode<State, Action>* node = root;
 			while (!node->isLeaf()) {
-				node = bestUCT(node);
+				node = bestUCT(node, rng);
+				if (node->chance) node = sampleOutcome(node, rng);
 			}
 			return node;
 		}
 
-		// 使用UCT公式選擇最佳子節點
-		MCTSNode<State, Action>* bestUCT(MCTSNode<State, Action>* node) {
+		// 在機會節點重新抽樣一個結果，回傳對應的子節點，沒有時加入新的子節點
+		MCTSNode<State, Action>* sampleOutcome(MCTSNode<State, Action>* node,
+		                                       std::mt19937& rng) {
+			State next_state = node->parent->state.applyAction(node->state.getLastAction(), rng);
+			int outcome = next_state.getLastOutcome();
+			MCTSNode<State, Action>* result = findOutcome(node, outcome);
+			if (result != nullptr) return result;
+
+			auto child = makeChild(next_state, node);
+			TRACE_LOCK_WAIT_BEGIN();
+			#pragma omp critical
+			{
+				TRACE_LOCK_WAIT_END();
+				// 其他線程可能已先加入相同的結果
+				for (const auto& other : node->children) {
+					if (other->state.getLastOutcome() == outcome) result = other.get();
+				}
+				if (result == nullptr) {
+					result = child.get();
+					node->children.push_back(std::move(child));
+					nodes++;
+				}
+			}
+			return result;
+		}
+
+		// 以選擇策略的分數挑出最佳子節點
+		MCTSNode<State, Action>* bestUCT(MCTSNode<State, Action>* node,
+		                                 std::mt19937& rng) {
 			MCTSNode<State, Action>* best_child = nullptr;
-			double best_uct = -std::numeric_limits<double>::infinity();
+			double best_score = -std::numeric_limits<double>::infinity();
 
+			TRACE_LOCK_WAIT_BEGIN();
 			#pragma omp critical
 			{
+				TRACE_LOCK_WAIT_END();
 				for (const auto& child : node->children) {
-					double uct_value = child->UCT(exploration_param);
-					if (uct_value > best_uct) {
-						best_uct = uct_value;
+					double score = selection.score(*child, rng);
+					if (score > best_score) {
+						best_score = score;
 						best_child = child.get();
 					}
 				}
@@ -131,45 +440,68 @@ class MCTS {
 		// 擴展節點 (Expansion)
 		MCTSNode<State, Action>* expand(MCTSNode<State, Action>* node,
 		                                std::mt19937& rng) {
-			if (!node->available_actions.empty()) {
-				Action action = node->getRandomUntriedAction(rng);
-				State next_state = node->state.applyAction(action);
-				std::vector<Action> next_actions =
-				    next_state.getAvailableActions();
-
+			TRACE_SCOPE(TRACE_EXPAND);
+			// 取出動作與加入子節點分兩段持有鎖，每個動作只會被展開一次；
+			// 動作已被其他線程取完時直接從 node 模擬
+			Action action;
+			double prior = 0;
+			bool picked;
+			{
+				TRACE_LOCK_WAIT_BEGIN();
 				#pragma omp critical
 				{
-					node->children.push_back(std::make_unique<MCTSNode<State, Action>>(next_state, next_actions, node));
+					TRACE_LOCK_WAIT_END();
+					picked = expansion.pick(*node, rng, action, prior);
 				}
-				return node->children.back().get();
 			}
-			return node;
+			if (!picked) return node;
+
+			State next_state = node->state.applyAction(action, rng);
+			std::unique_ptr<MCTSNode<State, Action>> child;
+			MCTSNode<State, Action>* result;
+			if (node->state.isChanceAction(action)) {
+				// 機會節點本身不展開動作，第一個結果成為它的子節點
+				child = std::make_unique<MCTSNode<State, Action>>(
+				    next_state, std::vector<Action>(), node);
+				child->chance = true;
+				child->children.push_back(makeChild(next_state, child.get()));
+				result = child->children.back().get();
+			} else {
+				child = makeChild(next_state, node);
+				result = child.get();
+			}
+			child->prior = prior;
+
+			TRACE_LOCK_WAIT_BEGIN();
+			#pragma omp critical
+			{
+				TRACE_LOCK_WAIT_END();
+				nodes += 1 + (int)child->children.size();
+				// 超過建構時的預留量會搬移 children，破壞不持鎖的走訪
+				assert(node->children.size() < node->children.capacity());
+				node->children.push_back(std::move(child));
+				node->child_count.store((int)node->children.size(), std::memory_order_release);
+			}
+			return result;
 		}
 
 		// 模擬 (Simulation)
 		double simulate(MCTSNode<State, Action>* node, std::mt19937& rng) {
-			State state = node->state;
-			while (!state.isTerminal()) {
-				std::vector<Action> actions = state.getAvailableActions();
-				Action action = actions[std::uniform_int_distribution<>(
-				    0, actions.size() - 1)(rng)];
-				state = state.applyAction(action);
-			}
-			return state.getResult();
+			TRACE_SCOPE(TRACE_SIMULATE);
+			return playout.simulate(node->state, rng, exact_value,
+			                        static_cast<std::vector<Action>*>(nullptr));
 		}
 
 		// 回傳 (Backpropagation)
 		void backpropagate(MCTSNode<State, Action>* node, double result) {
+			TRACE_SCOPE(TRACE_BACKPROPAGATE);
 			while (node != nullptr) {
-				#pragma omp atomic  // 確保訪問次數和勝利次數的同步
-				node->visits++;
-				#pragma omp atomic
-				node->wins += result;
+				backup.update(node, result);
 				node = node->parent;
 			}
 		}
 
-		// 找出最佳動作
+		// 找出最佳動作，根節點沒有子節點（沒有合法動作）時回傳 Action()
 		Action bestAction() const {
 			MCTSNode<State, Action>* best_child = nullptr;
 			int best_visits = -1;
@@ -181,16 +513,9 @@ class MCTS {
 				}
 			}
 
+			if (best_child == nullptr) return Action();
 			return best_child->state.getLastAction();
 		}
-
-		// 刪除樹節點
-		void deleteTree(MCTSNode<State, Action>* node) {
-			for (auto& child : node->children) {
-				deleteTree(child.get());
-			}
-			// delete node;
-		}
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,284 @@
+#ifndef MCTSPOLICY_H
+#define MCTSPOLICY_H
+
+#include <omp.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "Trace.h"
+
+// MCTS 的編譯期策略 (policy)，作為 MCTS 的模板參數，不經過虛擬函式
+//
+// Selection: double score(const Node& child, std::mt19937& rng) const
+//            分數最高的子節點會被選中
+// Expansion: bool pick(Node& node, std::mt19937& rng, Action& action, double& prior)
+//            從 node.untried_actions 取出一個動作與其先驗，沒有動作時回傳 false；
+//            呼叫時已持有樹的鎖
+// Playout:   double simulate(State state, std::mt19937& rng, const ExactValue&,
+//                            std::vector<Action>* trace)
+//            從 state 模擬到終局，回傳以 my_color 為視角的結果；
+//            trace 不為 nullptr 時依序記錄模擬中走過的動作
+// Backup:    void update(Node* node, double result)
+//            更新單一節點的統計，由葉節點往根節點呼叫
+//            uses_trace 為 true 時改呼叫 update(node, result, played)，
+//            played 為 node 之後（含模擬）出現過的動作
+//            records_squares 為 true 表示會累加 wins_sq（UCB1TunedSelection 需要）
+
+// UCT (UCB1)
+struct UCTSelection {
+	double exploration_param = 1.41;
+
+	template <typename Node>
+	double score(const Node& child, std::mt19937&) const {
+		return child.UCT(exploration_param);
+	}
+};
+
+// UCB1-Tuned：以結果的變異數調整探索項，需搭配 SquaredBackup
+struct UCB1TunedSelection {
+	template <typename Node>
+	double score(const Node& child, std::mt19937&) const {
+		int visits, parent_visits;
+		double wins, wins_sq;
+		#pragma omp atomic read
+		visits = child.visits;
+		if (visits == 0 || child.parent == nullptr) {
+			return std::numeric_limits<double>::infinity();
+		}
+		#pragma omp atomic read
+		wins = child.wins;
+		#pragma omp atomic read
+		wins_sq = child.wins_sq;
+		#pragma omp atomic read
+		parent_visits = child.parent->visits;
+
+		double mean = wins / visits;
+		double log_n = std::log(parent_visits);
+		double variance = wins_sq / visits - mean * mean +
+		                  std::sqrt(2 * log_n / visits);
+		// 結果介於 -1 ~ 1，變異數上限為 1
+		return mean + std::sqrt(log_n / visits * std::min(1.0, variance));
+	}
+};
+
+// Thompson sampling：把結果映射到 [0, 1]，從 Beta 後驗分布取樣
+struct ThompsonSelection {
+	template <typename Node>
+	double score(const Node& child, std::mt19937& rng) const {
+		int visits;
+		double wins;
+		#pragma omp atomic read
+		visits = child.visits;
+		#pragma omp atomic read
+		wins = child.wins;
+
+		double success = (wins + visits) / 2;
+		std::gamma_distribution<double> alpha(1 + success, 1.0);
+		std::gamma_distribution<double> beta(1 + visits - success, 1.0);
+		double x = alpha(rng), y = beta(rng);
+		return x / (x + y);
+	}
+};
+
+// RAVE：以 AMAF 統計補足訪問次數少的子節點，權重 beta = sqrt(k / (3n + k))
+// 隨訪問次數 n 遞減，需搭配 RaveBackup
+struct RaveSelection {
+	double exploration_param = 1.41;
+	double equivalence = 1000; // k：AMAF 與實際統計權重相等時的訪問次數量級
+
+	template <typename Node>
+	double score(const Node& child, std::mt19937&) const {
+		int visits, amaf_visits, parent_visits;
+		double wins, amaf_wins;
+		#pragma omp atomic read
+		visits = child.visits;
+		if (visits == 0) return std::numeric_limits<double>::infinity();
+		#pragma omp atomic read
+		wins = child.wins;
+		#pragma omp atomic read
+		amaf_visits = child.amaf_visits;
+		#pragma omp atomic read
+		amaf_wins = child.amaf_wins;
+
+		double value = wins / visits;
+		if (amaf_visits > 0) {
+			double beta = std::sqrt(equivalence / (3 * visits + equivalence));
+			value = (1 - beta) * value + beta * amaf_wins / amaf_visits;
+		}
+		if (child.parent == nullptr) return value;
+		#pragma omp atomic read
+		parent_visits = child.parent->visits;
+		return value + exploration_param * std::sqrt(std::log(parent_visits) / visits) +
+		       child.prior / (1 + visits);
+	}
+};
+
+// 隨機挑選未展開的動作
+struct RandomExpansion {
+	template <typename Node, typename Action>
+	bool pick(Node& node, std::mt19937& rng, Action& action, double& prior) {
+		if (node.untried_actions.empty()) return false;
+		action = node.getRandomUntriedAction(rng);
+		prior = 0;
+		return true;
+	}
+};
+
+// 依啟發式分數由高到低展開，分數乘上 weight 作為子節點的先驗
+// Heuristic: void operator()(const State&, const std::vector<Action>&,
+//                            std::vector<double>& scores) const
+// 第一次展開節點時才評分並排序，同分的動作順序隨機
+template <typename Heuristic>
+struct OrderedExpansion {
+	Heuristic heuristic;
+	double weight = 1.0;
+
+	template <typename Node, typename Action>
+	bool pick(Node& node, std::mt19937& rng, Action& action, double& prior) {
+		if (node.untried_actions.empty()) return false;
+		if (!node.untried_ordered) order(node, rng);
+		action = node.untried_actions.back();
+		prior = node.untried_priors.back();
+		node.untried_actions.pop_back();
+		node.untried_priors.pop_back();
+		return true;
+	}
+
+	private:
+		template <typename Node>
+		void order(Node& node, std::mt19937& rng) {
+			auto& actions = node.untried_actions;
+			std::shuffle(actions.begin(), actions.end(), rng);
+			std::vector<double> scores;
+			heuristic(node.state, actions, scores);
+
+			// 分數最高的放在尾端
+			std::vector<int> index(actions.size());
+			for (size_t i = 0; i < index.size(); i++) index[i] = i;
+			std::stable_sort(index.begin(), index.end(),
+			                 [&](int a, int b) { return scores[a] < scores[b]; });
+			auto sorted = actions;
+			node.untried_priors.resize(actions.size());
+			for (size_t i = 0; i < index.size(); i++) {
+				sorted[i] = actions[index[i]];
+				node.untried_priors[i] = weight * scores[index[i]];
+			}
+			actions.swap(sorted);
+			node.untried_ordered = true;
+		}
+};
+
+// 均勻隨機走步直到終局
+struct RandomPlayout {
+	template <typename State, typename Action>
+	double simulate(State state, std::mt19937& rng,
+	                const std::function<bool(const State&, double&)>& exact_value,
+	                std::vector<Action>* trace) {
+		double value;
+		while (!state.isTerminal()) {
+			if (exact_value && exact_value(state, value)) return value;
+			auto actions = state.getAvailableActions();
+			auto action = actions[std::uniform_int_distribution<>(
+			    0, actions.size() - 1)(rng)];
+			if (trace != nullptr) trace->push_back(action);
+			state = state.applyAction(action, rng);
+		}
+		return state.getResult();
+	}
+};
+
+// 平均結果：累加訪問次數與勝利次數
+struct AverageBackup {
+	static const bool uses_trace = false;
+	static const bool records_squares = false;
+
+	template <typename Node>
+	void update(Node* node, double result) {
+		#pragma omp atomic  // 確保訪問次數和勝利次數的同步
+		node->visits++;
+		#pragma omp atomic
+		node->wins += result;
+	}
+};
+
+// 平均結果並累加結果的平方（供 UCB1-Tuned 估計變異數）
+struct SquaredBackup {
+	static const bool uses_trace = false;
+	static const bool records_squares = true;
+
+	template <typename Node>
+	void update(Node* node, double result) {
+		#pragma omp atomic
+		node->visits++;
+		#pragma omp atomic
+		node->wins += result;
+		#pragma omp atomic
+		node->wins_sq += result * result;
+	}
+};
+
+// (玩家, action ID) 的集合，供 AMAF 判斷動作是否出現過
+class ActionSet {
+	public:
+		template <typename Action>
+		void insert(const Action& action) {
+			if (action.getActionID() < 0) return; // 根節點沒有上一手
+			size_t k = key(action);
+			if (k / 64 >= bits.size()) bits.resize(k / 64 + 1, 0);
+			bits[k / 64] |= 1ULL << (k % 64);
+		}
+
+		template <typename Action>
+		bool contains(const Action& action) const {
+			if (action.getActionID() < 0) return false;
+			size_t k = key(action);
+			return k / 64 < bits.size() && (bits[k / 64] >> (k % 64) & 1);
+		}
+
+	private:
+		std::vector<uint64_t> bits;
+
+		// 玩家為 RED / BLK / UNKNOWN
+		template <typename Action>
+		static size_t key(const Action& action) {
+			return (size_t)action.getActionID() * 4 + action.getPlayer();
+		}
+};
+
+// 平均結果，並以同一玩家之後走過的動作更新各子節點的 AMAF 統計
+struct RaveBackup {
+	static const bool uses_trace = true;
+	static const bool records_squares = false;
+
+	template <typename Node>
+	void update(Node* node, double result) {
+		#pragma omp atomic
+		node->visits++;
+		#pragma omp atomic
+		node->wins += result;
+	}
+
+	template <typename Node>
+	void update(Node* node, double result, const ActionSet& played) {
+		update(node, result);
+		// 只走訪已發布的子節點（children 預留了空間，加入時不會搬移），不需持有樹的鎖
+		int count = node->child_count.load(std::memory_order_acquire);
+		for (int i = 0; i < count; i++) {
+			const auto& child = node->children[i];
+			if (!played.contains(child->state.getLastAction())) continue;
+			#pragma omp atomic
+			child->amaf_visits++;
+			#pragma omp atomic
+			child->amaf_wins += result;
+		}
+	}
+};
+
+#endif
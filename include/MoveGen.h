@@ -0,0 +1,22 @@
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include "libchess.h"
+
+// 已翻開棋子的快速走法產生，供殘局庫生成與確定性搜尋使用
+// 規則與 DarkChess_State::isLegalAction 相同
+
+// sq 上下左右的相鄰格（共 4 個），超出棋盤的方向為 -1
+const int* neighborsOf(int sq);
+
+// (from, to) 在 ActionMap 中的 index，不存在時為 -1
+int actionIndex(int from, int to);
+
+// 炮/包從 from 沿四個方向翻山可吃到的目標格（不論顏色），回傳數量
+int cannonTargets(const FIN board[BOARD_SIZE], int from, int targets[4]);
+
+// 產生 color 方的所有移動與吃子（不含翻棋），寫入 action ID 並回傳數量
+// action_ids 至少需要 ACTION_SIZE 個空間
+int generateMoves(const FIN board[BOARD_SIZE], int color, int* action_ids);
+
+#endif
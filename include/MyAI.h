@@ -6,12 +6,52 @@
 #include <stdlib.h>
 #include <time.h>
 
+#include <memory>
 #include <string>
 
+#include "AlphaBeta.h"
 #include "DarkChess.h"
 #include "MCTS.h"
+#include "OpeningBook.h"
+#include "SharedMemory.h"
+#include "Symmetry.h"
+#include "Tablebase.h"
+#include "Tactics.h"
+#include "ThreadPool.h"
+#include "ValueNet.h"
 #include "libchess.h"
 
+// 價值網路跨線程批次評估的最長等待時間
+#define VNET_BATCH_TIMEOUT_US 50
+
+// 沒有時間限制時，殘局 alpha-beta 每次模擬換算的節點數（與一次隨機模擬的時間相當）
+#define AB_NODES_PER_PLAYOUT 1000
+
+// 內建 bench 的主種子與每個局面預設的模擬次數
+#define BENCH_SEED 12345
+#define BENCH_PLAYOUTS 1000
+
+// 搜尋使用的 MCTS：依吃子/威脅的啟發式排序展開並作為先驗，載入價值網路時以其評估葉節點。
+// make RAVE=1 改用 RAVE 選擇與 AMAF 回傳（尚未以對戰驗證優於 UCT）
+#ifdef CDC_RAVE
+typedef MCTS<DarkChess_State, DarkChess_Action, RaveSelection, TacticalExpansion,
+             ValueNetPlayout, RaveBackup>
+    SearchTree;
+#else
+typedef MCTS<DarkChess_State, DarkChess_Action, UCTSelection, TacticalExpansion,
+             ValueNetPlayout, AverageBackup>
+    SearchTree;
+#endif
+
+// 上一次 GenerateMove 的搜尋統計
+struct SearchStats {
+	int playouts;      // 完成的模擬次數
+	int nodes;         // 樹的節點數（alpha-beta 為搜尋的節點數）
+	int depth;         // alpha-beta 完成的深度，MCTS 為 0
+	double elapsed_ms; // 搜尋時間
+	bool book_hit;     // 是否由開局庫直接回傳
+};
+
 class MyAI {
 	public:
 		MyAI();
@@ -22,7 +62,20 @@ class MyAI {
 		void Flip(int sq, FIN f);
 		void SetColor(COLOR c);
 		void SetTime(COLOR c, int t);
+		void SetDeterministic(unsigned int seed);
+		void SetSimulationCount(int count);
+		void SetThreadCount(int count);
+		void SetPinThreads(bool pin);
+		void SetProcessCount(int count);
+		void SetTimeBudget(int ms);
+		bool SetPlayout(const char* name);
+		bool LoadBook(const char* path);
+		int LoadTablebase(const char* dir);
+		bool LoadValueNet(const char* path);
 		MOVE GenerateMove(int curr_color);
+		std::string Bench(int playouts);
+
+		const SearchStats& GetSearchStats() const { return search_stats; }
 
 		std::string GetProtocolVersion() const;
 		std::string GetAIName() const;
@@ -36,7 +89,25 @@ class MyAI {
 		int coverPieceCount[14];
 		int allCoverCount;
 
+		// search settings
+		bool deterministic;
+		unsigned int seed;
+		int simulation_count;
+		int thread_count;
+		bool pin_threads; // 搜尋線程綁定到固定的核心
+		int process_count; // 搜尋的行程數（含這個行程）
+		int time_budget;
+		bool heavy_playout; // 沒有價值網路時以 HeavyPlayout 模擬
+		SearchStats search_stats;
+
 		DarkChess_State curr_state;
+		OpeningBook book;
+		Tablebase tablebase;
+		ValueNet value_net;
+		bool use_files; // 是否使用載入的開局庫、殘局庫與價值網路（bench 時關閉）
+		// 沒有暗子後改用的搜尋，置換表跨回合保留
+		std::unique_ptr<AlphaBeta> endgame;
+		std::unique_ptr<ThreadPool> pool; // 搜尋線程，與行程同壽命
 };
 
 #endif
@@ -0,0 +1,62 @@
+#ifndef OPENINGBOOK_H
+#define OPENINGBOOK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// 開局庫檔案格式（little-endian）：
+//   BookHeader，接著 count 筆依 (key, action_id) 排序的 BookEntry
+struct BookHeader {
+	char magic[8];      // "CDCBOOK1"
+	uint32_t version;   // 格式版本
+	uint32_t count;     // BookEntry 數量
+	uint64_t reserved;
+};
+
+struct BookEntry {
+	uint64_t key;         // canonicalHash(state, side_to_move)，見 Symmetry.h
+	uint32_t visits;      // 該動作在搜尋中被訪問的次數
+	float score;          // 平均結果 (-1 ~ 1)，以輪到的玩家為視角
+	uint16_t action_id;   // ActionMap 的 index，為標準方向的動作
+	uint16_t reserved[3];
+};
+
+static_assert(sizeof(BookHeader) == 24, "unexpected BookHeader layout");
+static_assert(sizeof(BookEntry) == 24, "unexpected BookEntry layout");
+
+// 以 mmap 載入的唯讀開局庫
+class OpeningBook {
+	public:
+		// 2: key 與 action_id 改為對稱下的標準方向
+		static const uint32_t VERSION = 2;
+
+		int min_visits = 100; // 訪問次數低於此值的動作不採用
+
+		OpeningBook() = default;
+		~OpeningBook() { unload(); }
+
+		OpeningBook(const OpeningBook&) = delete;
+		OpeningBook& operator=(const OpeningBook&) = delete;
+
+		// 載入開局庫，失敗時回傳 false 並維持未載入狀態
+		bool load(const char* path);
+		void unload();
+		bool isLoaded() const { return entries != nullptr; }
+		uint32_t size() const { return count; }
+
+		// 查詢局面，找到可用的動作時回傳 true 並寫入 action_id
+		bool probe(uint64_t key, int& action_id) const;
+
+		// 將 entries 排序、合併相同 (key, action_id) 後寫成開局庫檔案
+		static bool write(const char* path, std::vector<BookEntry>& entries);
+
+	private:
+		void* mapping = nullptr;
+		size_t mapping_size = 0;
+		const BookEntry* entries = nullptr;
+		uint32_t count = 0;
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef PACKEDSTATE_H
+#define PACKEDSTATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+
+// 24 bytes 的局面快照，由 DarkChess_State::pack() / unpack() 轉換
+//
+// board:  每格 4 bits（FIN），第 sq 格位於 board[sq / 16] 的第 (sq % 16) * 4 位元
+// covers: 14 種暗子的剩餘數量，帥/將 1 bit、兵/卒 3 bits、其餘 2 bits
+// header: bit 0-1 上一手的玩家 (curr_player)、2-3 my_color、4-5 winner、
+//         6-13 無吃翻步數、14-22 上一步的 action ID + 1（0 為無）、
+//         23-24 上一步動作的玩家
+//
+// 不保存歷史動作（長捉判斷由 unpack 後重新累積）與剩餘時間。
+struct PackedState {
+	uint64_t board[2];
+	uint32_t covers;
+	uint32_t header;
+
+	bool operator==(const PackedState& other) const {
+		return board[0] == other.board[0] && board[1] == other.board[1] &&
+		       covers == other.covers && header == other.header;
+	}
+	bool operator!=(const PackedState& other) const { return !(*this == other); }
+
+	uint64_t hash() const {
+		uint64_t h = board[0] * 0x9E3779B97F4A7C15ULL;
+		h ^= (board[1] + (h << 6) + (h >> 2)) * 0xC2B2AE3D27D4EB4FULL;
+		h ^= ((uint64_t)covers << 32 | header) * 0x165667B19E3779F9ULL;
+		h ^= h >> 31;
+		h *= 0xBF58476D1CE4E5B9ULL;
+		return h ^ (h >> 29);
+	}
+
+	int getPiece(int sq) const { return (board[sq >> 4] >> ((sq & 15) * 4)) & 15; }
+	int getNoEatFlip() const { return (header >> 6) & 0xFF; }
+};
+
+static_assert(sizeof(PackedState) == 24, "unexpected PackedState layout");
+
+namespace std {
+template <>
+struct hash<PackedState> {
+	size_t operator()(const PackedState& state) const { return state.hash(); }
+};
+}  // namespace std
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef SHAREDMEMORY_H
+#define SHAREDMEMORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "libchess.h"
+
+// 多行程搜尋用的共享記憶體
+//
+// 以 mmap(MAP_SHARED | MAP_ANONYMOUS) 配置，內容初始為 0；之後 fork 出的子行程
+// 與父行程看到同一份資料。只放一般資料與 lock-free 的 std::atomic，不使用鎖。
+
+void* mapShared(size_t bytes); // 失敗時回傳 nullptr
+void unmapShared(void* addr, size_t bytes);
+
+template <typename T>
+class SharedArray {
+	public:
+		explicit SharedArray(size_t count = 0) { allocate(count); }
+		~SharedArray() { release(); }
+
+		SharedArray(const SharedArray&) = delete;
+		SharedArray& operator=(const SharedArray&) = delete;
+
+		// 重新配置 count 個元素，失敗時回傳 false 並維持為空
+		bool allocate(size_t count) {
+			release();
+			if (count == 0) return true;
+			void* addr = mapShared(count * sizeof(T));
+			if (addr == nullptr) return false;
+			items = static_cast<T*>(addr);
+			item_count = count;
+			return true;
+		}
+
+		void release() {
+			if (items != nullptr) unmapShared(items, item_count * sizeof(T));
+			items = nullptr;
+			item_count = 0;
+		}
+
+		size_t size() const { return item_count; }
+		T* data() { return items; }
+		T& operator[](size_t i) { return items[i]; }
+		const T& operator[](size_t i) const { return items[i]; }
+
+	private:
+		T* items = nullptr;
+		size_t item_count = 0;
+};
+
+// 各行程根節點統計的合計（action ID -> 訪問次數、勝利次數）
+// 勝利次數以 WIN_SCALE 的定點數累加，只用 fetch_add
+//
+// MCTS 的行程在搜尋中不共享任何資料，只在結束時合併根節點 (root parallelization)：
+// 樹的節點是各行程 heap 上的指標結構，無法放進共享記憶體；以雜湊表共享節點統計
+// 則每次選擇與回傳都要跨行程存取，而且翻棋的結果不同使各行程的樹形狀不同。
+// 根節點合併的效果與共享樹相近，搜尋中沒有同步成本。alpha-beta 的置換表則以
+// 局面雜湊為鍵，可直接共享（見 AlphaBeta）
+struct SharedRootStats {
+	static constexpr double WIN_SCALE = 1 << 20;
+
+	std::atomic<int64_t> visits[ACTION_SIZE];
+	std::atomic<int64_t> wins[ACTION_SIZE];
+	std::atomic<int64_t> playouts;
+	std::atomic<int64_t> nodes;
+
+	void add(const std::map<int, std::pair<int, double>>& stats, int playouts,
+	         int nodes);
+
+	// 訪問次數最多的動作，相同時取 action ID 較小者；沒有統計時回傳 -1
+	int best() const;
+};
+
+static_assert(sizeof(std::atomic<int64_t>) == sizeof(int64_t),
+              "shared counters must be plain 64-bit words");
+
+// fork 出 count 個子行程，各自執行 fn(worker)（worker 為 1 ~ count）後以 _exit 結束，
+// 不會執行父行程的解構與 stdio 的 flush。回傳成功建立的子行程
+// 子行程只有呼叫 fork 的線程，不可使用父行程的 ThreadPool 與 OpenMP 線程
+std::vector<pid_t> forkWorkers(int count, const std::function<void(int worker)>& fn);
+
+// 等待所有子行程結束，回傳非正常結束的數量
+int waitWorkers(const std::vector<pid_t>& pids);
+
+#endif
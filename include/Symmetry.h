@@ -0,0 +1,38 @@
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "DarkChess.h"
+#include "libchess.h"
+
+// 棋盤的對稱：4×8 的棋盤左右、上下鏡射後規則不變（吃子只看相鄰，炮/包
+// 只看直線），暗子也是均勻抽取，因此互為鏡像的局面價值相同。
+// 每個對稱都是自己的反函數，四者構成一個群。
+enum SYMMETRY : int {
+	SYM_IDENTITY,
+	SYM_MIRROR_COL, // 左右鏡射：col -> 3 - col
+	SYM_MIRROR_ROW, // 上下鏡射：row -> 7 - row
+	SYM_ROTATE,     // 兩者皆做（旋轉 180 度）
+
+	SYM_COUNT,
+};
+
+int transformSquare(int sq, int symmetry);
+int transformAction(int action_id, int symmetry);
+
+// 盤面在哪些對稱下不變（各類暗子數量與方向無關），bit i 對應 SYMMETRY i
+int boardSymmetries(const DarkChess_State& state);
+
+// 四個方向中最小的 Zobrist 雜湊（標準方向），symmetry 為把 state 轉到
+// 標準方向的對稱；標準方向的動作以 transformAction(action, symmetry) 互轉
+uint64_t canonicalHash(const DarkChess_State& state, int side_to_move, int& symmetry);
+
+// 去除在盤面對稱下等價的動作，每組只保留 action ID 最小者
+// 無吃翻步數已可能構成長捉時不處理（長捉與歷史動作的方向有關）
+void dedupeSymmetricActions(const DarkChess_State& state,
+                            std::vector<DarkChess_Action>& actions);
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <unordered_map>
+
+#include "DarkChess.h"
+#include "libchess.h"
+
+// 全部翻開、子數不多的殘局庫（逆向分析產生）
+//
+// 每種子力組合（material）一個檔案 <dir>/<material>.tb，檔名為排序後的
+// 棋子編號（十六進位）。檔案內容為 TablebaseHeader 與
+// 2 * placements 個 uint16_t：index = side_to_move * placements + 擺法的完美雜湊，
+// 值為 (dtz << 2) | wdl，wdl 為 TB_DRAW / TB_WIN / TB_LOSS（以輪到的一方為視角），
+// dtz 為距離下一次吃子或終局的步數。
+//
+// 表只記錄盤面，不含歷史動作，因此逆向分析不考慮長捉（LONG_CATCH_LIMIT）：
+// 勝方的最短路線不會重複局面，但若雙方已在重複同一個循環，表中的勝負
+// 可能因長捉判和而不成立，probe(state) 對這類局面回傳 false。
+struct TablebaseHeader {
+	char magic[8];         // "CDCTB001"
+	uint32_t version;
+	uint32_t piece_count;
+	uint8_t pieces[8];     // 由小到大排序的棋子
+	uint64_t placements;   // 擺法數量
+};
+
+static_assert(sizeof(TablebaseHeader) == 32, "unexpected TablebaseHeader layout");
+
+enum TB_RESULT : int {
+	TB_DRAW = 0,
+	TB_WIN = 1,
+	TB_LOSS = 2,
+};
+
+class Tablebase {
+	public:
+		static const uint32_t VERSION = 1;
+		static const int MAX_PIECES = 8;
+
+		Tablebase() = default;
+		~Tablebase() { unload(); }
+
+		Tablebase(const Tablebase&) = delete;
+		Tablebase& operator=(const Tablebase&) = delete;
+
+		// 以 mmap 載入目錄中所有的殘局庫檔案，回傳載入的檔案數
+		int load(const char* dir);
+		void unload();
+		bool isLoaded() const { return !tables.empty(); }
+		int maxPieces() const { return max_pieces; }
+
+		// 查詢沒有暗子的盤面，result 為 1（勝）、0（和）、-1（負），以 side_to_move 為視角
+		// 沒有對應的表時回傳 false
+		bool probe(const FIN board[BOARD_SIZE], int side_to_move, int& result,
+		           int& dtz) const;
+
+		// 勝負能否在無吃翻步數限制內分出：dtz 步中只有最後一步吃子，
+		// 之前的 dtz - 1 步不可使無吃翻步數達到限制
+		static bool withinNoEatFlip(int no_eat_flip, int dtz) {
+			return no_eat_flip + dtz <= NO_EAT_FLIP_LIMIT;
+		}
+
+		// MCTS 用：回傳以 state 的 my_color 為視角的確定結果
+		// 有暗子、找不到表、已在長捉循環中，或勝負無法在無吃翻步數限制內分出時回傳 false
+		bool probe(const DarkChess_State& state, double& value) const;
+
+		// 產生所有至多 max_pieces 子、雙方皆有子的殘局庫並寫入 dir
+		static bool generate(const char* dir, int max_pieces, FILE* log);
+
+	private:
+		struct Table {
+			void* mapping;
+			size_t mapping_size;
+			const uint16_t* entries;
+			uint64_t placements;
+		};
+
+		std::unordered_map<uint64_t, Table> tables; // key 為子力組合
+		int max_pieces = 0;
+};
+
+#endif
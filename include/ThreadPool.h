@@ -0,0 +1,66 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 常駐的工作執行緒池
+//
+// 每個 worker 有自己的工作佇列：從自己佇列的尾端取工作，佇列空了就從
+// 其他 worker 佇列的前端偷取。pin 為 true 時 worker 綁定到固定的 CPU 核心；
+// 每個行程都從第一個允許的核心開始綁定，多個行程同時執行時會擠在相同的核心上，
+// 因此預設不綁定。
+// 工作內可用 worker 編號（0 ~ size()-1）取得 worker 私有的資料。
+class ThreadPool {
+	public:
+		typedef std::function<void(int worker)> Task;
+
+		explicit ThreadPool(int threads, bool pin = false);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		int size() const { return (int)workers.size(); }
+
+		// 提交背景工作
+		void submit(Task task);
+
+		// 等待目前所有已提交的工作完成
+		void wait();
+
+		// 平行執行 fn(worker, i)，i = 0 ~ count-1，每 grain 個 i 為一個工作，
+		// 完成前會阻塞。fn 回傳 false 時要求停止，尚未開始的 i 不再執行。
+		// 不可在 pool 的工作內呼叫。
+		void parallelFor(int count, int grain,
+		                 const std::function<bool(int worker, int index)>& fn);
+
+	private:
+		struct Queue {
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		std::vector<std::thread> workers;
+		std::vector<std::unique_ptr<Queue>> queues;
+		std::atomic<int> next_queue{0}; // submit 輪流放入的佇列
+
+		std::mutex sleep_mutex;
+		std::condition_variable sleep_cv; // 有新工作或結束
+		std::condition_variable idle_cv;  // 所有工作完成
+		int queued = 0;                   // 佇列中的工作數，由 sleep_mutex 保護
+		int running = 0;                  // 執行中的工作數，由 sleep_mutex 保護
+		bool shutting_down = false;
+
+		void push(int queue, Task task);
+		bool pop(int worker, Task& task);
+		void workerLoop(int worker, bool pin);
+};
+
+#endif
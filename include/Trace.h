@@ -0,0 +1,77 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// 熱路徑追蹤：以 make TRACE=1 (-DCDC_TRACE) 編譯時才會記錄
+//
+// 每個線程有自己的環狀緩衝區，記錄各階段的 TSC 時間區間；緩衝區滿時
+// 覆寫最舊的事件，另外累計各階段的 log2 直方圖（不受覆寫影響）。
+// 可匯出為 Chrome trace JSON（chrome://tracing、Perfetto）。
+enum TRACE_PHASE : int {
+	TRACE_GENMOVE,
+	TRACE_SELECT,
+	TRACE_EXPAND,
+	TRACE_SIMULATE,
+	TRACE_BACKPROPAGATE,
+	TRACE_LOCK_WAIT, // 等待 omp critical
+
+	TRACE_PHASE_COUNT,
+};
+
+class Trace {
+	public:
+		// 清除舊資料並開始記錄
+		static void start();
+		static void stop();
+		static bool isEnabled();
+
+		static bool writeChrome(const char* path);
+		static void writeHistogram(FILE* fp);
+
+		static void record(int phase, uint64_t begin, uint64_t end);
+
+		static inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+			return __rdtsc();
+#else
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			           std::chrono::steady_clock::now().time_since_epoch())
+			    .count();
+#endif
+		}
+};
+
+class TraceScope {
+	public:
+		explicit TraceScope(int phase) : phase(phase), begin(Trace::now()) {}
+		~TraceScope() { Trace::record(phase, begin, Trace::now()); }
+
+	private:
+		int phase;
+		uint64_t begin;
+};
+
+#ifdef CDC_TRACE
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+// 記錄目前區塊的執行時間
+#define TRACE_SCOPE(phase) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(phase)
+// 放在 omp critical 之前與區段內的第一行，記錄等待鎖的時間
+#define TRACE_LOCK_WAIT_BEGIN() uint64_t trace_lock_begin = Trace::now()
+#define TRACE_LOCK_WAIT_END() \
+	Trace::record(TRACE_LOCK_WAIT, trace_lock_begin, Trace::now())
+#else
+#define TRACE_SCOPE(phase) ((void)0)
+#define TRACE_LOCK_WAIT_BEGIN() ((void)0)
+#define TRACE_LOCK_WAIT_END() ((void)0)
+#endif
+
+#endif
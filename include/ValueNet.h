@@ -0,0 +1,148 @@
+#ifndef VALUENET_H
+#define VALUENET_H
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include "DarkChess.h"
+#include "MCTSPolicy.h"
+#include "Tactics.h"
+#include "libchess.h"
+
+// int8 量化的小型價值網路，取代葉節點的隨機模擬
+//
+// 輸入（以紅方為準的絕對顏色）：
+//   每格的棋子 (32 格 x 15 種，含暗子)、14 種暗子的剩餘數量、
+//   輪到的一方 (2) 與無吃翻步數
+// 架構：INPUTS -> HIDDEN1 (int16 累加，稀疏) -> HIDDEN2 (int8) -> 1，
+//   隱藏層皆為限制在 [0, 1] 的 ReLU，輸出經 tanh 為紅方視角的價值 [-1, 1]
+//
+// 權重檔為 ValueNetHeader 之後依序存放 w1, b1, w2, b2, w3, b3（小端序）
+struct ValueNetHeader {
+	char magic[8];    // "CDCVNET1"
+	uint32_t version;
+	uint32_t inputs;
+	uint32_t hidden1;
+	uint32_t hidden2;
+};
+
+static_assert(sizeof(ValueNetHeader) == 24, "unexpected ValueNetHeader layout");
+
+class ValueNet {
+	public:
+		static const uint32_t VERSION = 1;
+
+		static const int PIECE_FEATURES = BOARD_SIZE * 15;
+		static const int COVER_FEATURE = PIECE_FEATURES;     // 14 個
+		static const int SIDE_FEATURE = COVER_FEATURE + 14;  // 2 個
+		static const int NO_EAT_FLIP_FEATURE = SIDE_FEATURE + 2;
+		static const int INPUTS = NO_EAT_FLIP_FEATURE + 1;
+		static const int HIDDEN1 = 64;
+		static const int HIDDEN2 = 32;
+
+		// 量化比例：激活值 1.0 對應 QA，權重 1.0 對應 QB
+		static const int QA = 127;
+		static const int QB = 64;
+
+		// 特徵：index 與其值（棋子特徵的值為 1）
+		struct Feature {
+			int index;
+			int value;
+		};
+
+		bool load(const char* path);
+		bool save(const char* path) const;
+		bool isLoaded() const { return loaded; }
+
+		// 以隨機權重初始化，供 benchmark 使用
+		void initRandom(unsigned int seed);
+
+		// 由浮點權重量化（w1 為 [INPUTS][HIDDEN1]、w2 為 [HIDDEN2][HIDDEN1]）
+		void quantize(const float* w1, const float* b1, const float* w2,
+		              const float* b2, const float* w3, float b3);
+
+		// 盤面的特徵，回傳特徵數
+		static int features(const DarkChess_State& state, Feature* out);
+
+		// 紅方視角的價值
+		float evaluate(const DarkChess_State& state) const;
+
+		// 一次評估多個盤面，第二層的權重在批次內共用
+		void evaluate(const DarkChess_State* const* states, int count,
+		              float* values) const;
+
+	private:
+		alignas(32) int16_t w1[INPUTS][HIDDEN1];
+		alignas(32) int16_t b1[HIDDEN1];
+		alignas(32) int8_t w2[HIDDEN2][HIDDEN1];
+		alignas(32) int32_t b2[HIDDEN2];
+		alignas(32) int8_t w3[HIDDEN2];
+		int32_t b3 = 0;
+		bool loaded = false;
+
+		void hidden(const DarkChess_State& state, uint8_t* out) const;
+		float output(const uint8_t* h1) const;
+};
+
+// 跨線程合併葉節點評估：湊滿 batch_size 個請求或等待超過 timeout_us
+// 時，由當時等待的線程一次評估整批
+class ValueBatcher {
+	public:
+		ValueBatcher(const ValueNet& net, int batch_size, double timeout_us)
+		    : net(net), batch_size(batch_size), timeout_us(timeout_us) {}
+
+		float evaluate(const DarkChess_State& state);
+
+		long batches = 0;     // 評估過的批次數
+		long evaluations = 0; // 評估過的盤面數
+
+	private:
+		struct Request {
+			const DarkChess_State* state;
+			float value;
+			bool taken;
+			bool done;
+		};
+
+		const ValueNet& net;
+		int batch_size;
+		double timeout_us;
+
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::vector<Request*> pending;
+
+		void flush(std::unique_lock<std::mutex>& lock);
+};
+
+// 以價值網路評估葉節點的模擬策略，未載入網路時退回隨機模擬
+struct ValueNetPlayout {
+	const ValueNet* net = nullptr;
+	ValueBatcher* batcher = nullptr; // 不為 nullptr 時跨線程批次評估
+	bool heavy = false;              // 退回模擬時改用 HeavyPlayout
+
+	template <typename Action>
+	double simulate(const DarkChess_State& state, std::mt19937& rng,
+	                const std::function<bool(const DarkChess_State&, double&)>& exact_value,
+	                std::vector<Action>* trace) {
+		if (net == nullptr || !net->isLoaded()) {
+			if (heavy) return HeavyPlayout().simulate(state, rng, exact_value, trace);
+			return RandomPlayout().simulate(state, rng, exact_value, trace);
+		}
+		double value;
+		if (state.isTerminal()) return state.getResult();
+		if (exact_value && exact_value(state, value)) return value;
+
+		int my_color = state.getMyColor();
+		if (my_color == UNKNOWN) return 0;
+		float red = batcher != nullptr ? batcher->evaluate(state) : net->evaluate(state);
+		return my_color == RED ? red : -red;
+	}
+};
+
+#endif
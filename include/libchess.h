@@ -2,6 +2,7 @@
 #define LIBCHESS_H
 
 #include <array>
+#include <string>
 #include <string.h>
 
 static const int BOARD_SIZE = 32;
@@ -0,0 +1,388 @@
+#include "AlphaBeta.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "MoveGen.h"
+#include "Symmetry.h"
+#include "Tactics.h"
+
+namespace {
+
+const int INF = 32000;
+const int MOBILITY_WEIGHT = 4; // 每個走步的分數，子力以帥/將 = 1000 計
+
+// 搜尋專用的 Zobrist 雜湊表（沒有暗子，只需盤面與輪到的一方）
+struct ZobristTable {
+	uint64_t piece[BOARD_SIZE][FIN_COUNT];
+	uint64_t side[2];
+
+	ZobristTable() {
+		uint64_t x = 0xA0761D6478BD642FULL;
+		auto next = [&x]() { // splitmix64
+			uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			return z ^ (z >> 31);
+		};
+		for (auto& sq : piece)
+			for (auto& key : sq) key = next();
+		for (auto& key : side) key = next();
+	}
+};
+
+const ZobristTable zobrist;
+
+struct PieceScore {
+	int score[FIN_COUNT];
+
+	PieceScore() {
+		for (int f = 0; f < FIN_COUNT; f++) score[f] = (int)(pieceValue(FIN(f)) * 1000);
+	}
+};
+
+const PieceScore piece_score;
+
+// 勝負分數與步數有關，存進置換表時改為相對於該節點
+int scoreToTable(int score, int ply) {
+	if (score >= AlphaBeta::TB_WIN_SCORE - AlphaBeta::MAX_PLY) return score + ply;
+	if (score <= -AlphaBeta::TB_WIN_SCORE + AlphaBeta::MAX_PLY) return score - ply;
+	return score;
+}
+
+int scoreFromTable(int score, int ply) {
+	if (score >= AlphaBeta::TB_WIN_SCORE - AlphaBeta::MAX_PLY) return score - ply;
+	if (score <= -AlphaBeta::TB_WIN_SCORE + AlphaBeta::MAX_PLY) return score + ply;
+	return score;
+}
+
+}  // namespace
+
+AlphaBeta::AlphaBeta(int tt_bits) {
+	if (!table.allocate((size_t)1 << tt_bits)) {
+		tt_bits = 0;
+		table.allocate(1);
+	}
+	table_mask = ((uint64_t)1 << tt_bits) - 1;
+	clear();
+}
+
+bool AlphaBeta::applies(const DarkChess_State& state) {
+	return state.getChessCount(FIN_COVER) == 0 && state.getSideToMove() != UNKNOWN;
+}
+
+void AlphaBeta::clear() {
+	for (size_t i = 0; i < table.size(); i++) {
+		table[i].check.store(0, std::memory_order_relaxed);
+		table[i].data.store(0, std::memory_order_relaxed);
+	}
+	memset(history, 0, sizeof(history));
+	memset(killers, -1, sizeof(killers));
+}
+
+int AlphaBeta::search(const DarkChess_State& state) {
+	start = std::chrono::steady_clock::now();
+	stopped = false;
+	nodes = 0;
+	depth = 0;
+	score = 0;
+
+	side = state.getSideToMove();
+	no_eat_flip = state.getNoEatFlip();
+	pieces = 0;
+	for (int s = 0; s < SYM_COUNT; s++) keys[s] = zobrist.side[side];
+	for (int sq = 0; sq < BOARD_SIZE; sq++) {
+		board[sq] = state.getPiece(sq);
+		for (int s = 0; s < SYM_COUNT; s++) {
+			keys[s] ^= zobrist.piece[transformSquare(sq, s)][board[sq]];
+		}
+		if (board[sq] != FIN_EMPTY) pieces++;
+	}
+	hashes.assign(1, keys[SYM_IDENTITY]);
+
+	// 長捉的判斷需要對局中的最後幾步
+	const auto& game = state.getHistory();
+	moves.clear();
+	size_t keep = std::min(game.size(), (size_t)LONG_CATCH_LIMIT * 4);
+	for (size_t i = game.size() - keep; i < game.size(); i++) {
+		moves.push_back(game[i].getActionID());
+	}
+
+	int ids[ACTION_SIZE];
+	int n = generateMoves(board, side, ids);
+	if (n == 0) return -1;
+
+	// 舊的 killer 與 history 只保留一半的權重
+	for (auto& h : history) h /= 2;
+	memset(killers, -1, sizeof(killers));
+
+	int best = ids[0];
+	for (int d = start_depth; d <= max_depth; d++) {
+		root_best = -1;
+		int value = negamax(d, -INF, INF, 0);
+		if (stopped) break;
+		if (root_best >= 0) best = root_best;
+		depth = d;
+		score = value;
+		// 已找到確定的勝負
+		if (std::abs(value) >= WIN_SCORE - MAX_PLY) break;
+		if (checkStop()) break;
+	}
+	return best;
+}
+
+bool AlphaBeta::checkStop() {
+	if (node_limit > 0 && nodes >= node_limit) stopped = true;
+	if (stop_flag != nullptr && stop_flag->load(std::memory_order_relaxed)) {
+		stopped = true;
+	}
+	if (time_limit > 0 && std::chrono::duration<double, std::milli>(
+	                          std::chrono::steady_clock::now() - start)
+	                              .count() >= time_limit) {
+		stopped = true;
+	}
+	return stopped;
+}
+
+// 走步前後的雜湊差異（XOR 兩次即還原）
+void AlphaBeta::toggleKeys(int from, int to, FIN piece, FIN captured) {
+	for (int s = 0; s < SYM_COUNT; s++) {
+		int f = transformSquare(from, s), t = transformSquare(to, s);
+		keys[s] ^= zobrist.piece[f][piece] ^ zobrist.piece[f][FIN_EMPTY] ^
+		           zobrist.piece[t][captured] ^ zobrist.piece[t][piece] ^
+		           zobrist.side[RED] ^ zobrist.side[BLK];
+	}
+}
+
+AlphaBeta::Undo AlphaBeta::makeMove(int action_id) {
+	int from = ActionMap[action_id].first;
+	int to = ActionMap[action_id].second;
+	Undo undo = {board[to], no_eat_flip};
+
+	toggleKeys(from, to, board[from], board[to]);
+	if (undo.captured != FIN_EMPTY) {
+		pieces--;
+		no_eat_flip = 0;
+	} else {
+		no_eat_flip++;
+	}
+	board[to] = board[from];
+	board[from] = FIN_EMPTY;
+	side ^= 1;
+
+	hashes.push_back(keys[SYM_IDENTITY]);
+	moves.push_back(action_id);
+	return undo;
+}
+
+void AlphaBeta::unmakeMove(int action_id, const Undo& undo) {
+	int from = ActionMap[action_id].first;
+	int to = ActionMap[action_id].second;
+
+	side ^= 1;
+	board[from] = board[to];
+	board[to] = undo.captured;
+	if (undo.captured != FIN_EMPTY) pieces++;
+	no_eat_flip = undo.no_eat_flip;
+
+	toggleKeys(from, to, board[from], undo.captured);
+	hashes.pop_back();
+	moves.pop_back();
+}
+
+// 無吃翻步數已滿、長捉（與 DarkChess_State::isTerminal 相同），或與
+// 上一次吃子後、同一方輪走的局面重複
+bool AlphaBeta::isDraw() const {
+	if (no_eat_flip >= NO_EAT_FLIP_LIMIT) return true;
+
+	int size = moves.size();
+	if (no_eat_flip >= LONG_CATCH_LIMIT * 4 && size >= LONG_CATCH_LIMIT * 4) {
+		bool cycle = true;
+		for (int i = 1; i < LONG_CATCH_LIMIT && cycle; i++) {
+			for (int k = 1; k <= 4; k++) {
+				if (moves[size - i * 4 - k] != moves[size - k]) cycle = false;
+			}
+		}
+		if (cycle) return true;
+	}
+
+	int last = hashes.size() - 1;
+	int reversible = std::min(no_eat_flip, last);
+	for (int k = 4; k <= reversible; k += 2) {
+		if (hashes[last - k] == hashes[last]) return true;
+	}
+	return false;
+}
+
+int AlphaBeta::evaluate(int side_moves) const {
+	int opp = side ^ 1;
+	int material = 0;
+	for (int sq = 0; sq < BOARD_SIZE; sq++) {
+		FIN f = board[sq];
+		if (f == FIN_EMPTY) continue;
+		material += color_of(f) == side ? piece_score.score[f] : -piece_score.score[f];
+	}
+	int ids[ACTION_SIZE];
+	int opp_moves = generateMoves(board, opp, ids);
+	return material + MOBILITY_WEIGHT * (side_moves - opp_moves);
+}
+
+bool AlphaBeta::probe(uint64_t key, Data& data) const {
+	const Entry& entry = table[key & table_mask];
+	uint64_t word = entry.data.load(std::memory_order_relaxed);
+	if ((entry.check.load(std::memory_order_relaxed) ^ word) != key) return false;
+	memcpy(&data, &word, sizeof(word));
+	return true;
+}
+
+void AlphaBeta::store(uint64_t key, const Data& data) {
+	Entry& entry = table[key & table_mask];
+	uint64_t word;
+	memcpy(&word, &data, sizeof(word));
+	entry.data.store(word, std::memory_order_relaxed);
+	entry.check.store(key ^ word, std::memory_order_relaxed);
+}
+
+int AlphaBeta::orderScore(int action_id, int tt_move, int ply) const {
+	if (action_id == tt_move) return 1 << 30;
+	FIN victim = board[ActionMap[action_id].second];
+	if (victim != FIN_EMPTY) {
+		FIN attacker = board[ActionMap[action_id].first];
+		return (1 << 29) + piece_score.score[victim] * 16 - piece_score.score[attacker] / 16;
+	}
+	if (action_id == killers[ply][0]) return (1 << 28) + 1;
+	if (action_id == killers[ply][1]) return 1 << 28;
+	return history[action_id];
+}
+
+int AlphaBeta::negamax(int depth, int alpha, int beta, int ply) {
+	nodes++;
+	if ((nodes & 1023) == 0 && checkStop()) return 0;
+	if (stopped) return 0;
+
+	if (ply > 0) {
+		if (isDraw()) return 0;
+
+		// 殘局庫的勝負需在無吃翻步數限制內完成
+		int result, dtz;
+		if (tablebase != nullptr && pieces <= tablebase->maxPieces() &&
+		    tablebase->probe(board, side, result, dtz)) {
+			if (result == 0) return 0;
+			if (Tablebase::withinNoEatFlip(no_eat_flip, dtz)) {
+				return result > 0 ? TB_WIN_SCORE - ply : -(TB_WIN_SCORE - ply);
+			}
+		}
+	}
+	if (depth <= 0 || ply >= MAX_PLY - 1) return quiesce(alpha, beta, ply);
+
+	// 標準方向的鍵，置換表中的走步以 transformAction 互轉
+	int symmetry = SYM_IDENTITY;
+	for (int s = 1; s < SYM_COUNT; s++) {
+		if (keys[s] < keys[symmetry]) symmetry = s;
+	}
+	uint64_t key = keys[symmetry];
+	Data entry;
+	bool hit = probe(key, entry);
+	int tt_move = -1;
+	if (hit) {
+		if (entry.move >= 0) tt_move = transformAction(entry.move, symmetry);
+		if (ply > 0 && entry.depth >= depth) {
+			int value = scoreFromTable(entry.score, ply);
+			if (entry.bound == BOUND_EXACT ||
+			    (entry.bound == BOUND_LOWER && value >= beta) ||
+			    (entry.bound == BOUND_UPPER && value <= alpha)) {
+				return value;
+			}
+		}
+	}
+
+	int ids[ACTION_SIZE], order[ACTION_SIZE];
+	int n = generateMoves(board, side, ids);
+	if (n == 0) return -(WIN_SCORE - ply); // 沒有走步判負
+	for (int i = 0; i < n; i++) order[i] = orderScore(ids[i], tt_move, ply);
+
+	int alpha_orig = alpha;
+	int best_value = -INF, best_move = -1;
+	for (int i = 0; i < n; i++) {
+		// 依序取出排序分數最高的走步
+		int k = std::max_element(order + i, order + n) - order;
+		std::swap(ids[i], ids[k]);
+		std::swap(order[i], order[k]);
+		int id = ids[i];
+		bool capture = board[ActionMap[id].second] != FIN_EMPTY;
+
+		Undo undo = makeMove(id);
+		int value = -negamax(depth - 1, -beta, -alpha, ply + 1);
+		unmakeMove(id, undo);
+		if (stopped) return 0;
+
+		if (value > best_value) {
+			best_value = value;
+			best_move = id;
+			if (ply == 0) root_best = id;
+		}
+		if (value > alpha) alpha = value;
+		if (alpha >= beta) {
+			if (!capture) {
+				if (killers[ply][0] != id) {
+					killers[ply][1] = killers[ply][0];
+					killers[ply][0] = id;
+				}
+				history[id] += depth * depth;
+			}
+			break;
+		}
+	}
+
+	// 深度優先取代
+	if (!hit || depth >= entry.depth) {
+		entry.score = scoreToTable(best_value, ply);
+		entry.move = best_move >= 0 ? transformAction(best_move, symmetry) : -1;
+		entry.depth = depth;
+		entry.bound = best_value <= alpha_orig ? BOUND_UPPER
+		              : best_value >= beta     ? BOUND_LOWER
+		                                       : BOUND_EXACT;
+		entry.unused = 0;
+		store(key, entry);
+	}
+	return best_value;
+}
+
+int AlphaBeta::quiesce(int alpha, int beta, int ply) {
+	nodes++;
+	if ((nodes & 1023) == 0 && checkStop()) return 0;
+	if (stopped) return 0;
+
+	int ids[ACTION_SIZE];
+	int n = generateMoves(board, side, ids);
+	if (n == 0) return -(WIN_SCORE - ply);
+
+	int stand_pat = evaluate(n);
+	if (stand_pat >= beta || ply >= MAX_PLY - 1) return stand_pat;
+	if (stand_pat > alpha) alpha = stand_pat;
+
+	// 只搜吃子（吃子後無吃翻步數歸零，不會形成和局）
+	int order[ACTION_SIZE], m = 0;
+	for (int i = 0; i < n; i++) {
+		if (board[ActionMap[ids[i]].second] == FIN_EMPTY) continue;
+		ids[m] = ids[i];
+		order[m++] = orderScore(ids[i], -1, ply);
+	}
+
+	for (int i = 0; i < m; i++) {
+		int k = std::max_element(order + i, order + m) - order;
+		std::swap(ids[i], ids[k]);
+		std::swap(order[i], order[k]);
+
+		Undo undo = makeMove(ids[i]);
+		int value = -quiesce(-beta, -alpha, ply + 1);
+		unmakeMove(ids[i], undo);
+		if (stopped) return 0;
+
+		if (value >= beta) return value;
+		if (value > alpha) alpha = value;
+	}
+	return alpha;
+}
@@ -1,7 +1,39 @@
 #include "DarkChess.h"
 
+#include <algorithm>
+
+#include "Symmetry.h"
+
 // std::mt19937 random{std::random_device{}()};
 
+namespace {
+
+// Zobrist 雜湊表，以固定種子產生，確保不同執行檔之間雜湊值一致
+struct ZobristTable {
+	uint64_t piece[BOARD_SIZE][FIN_COUNT];
+	uint64_t cover[14][6];
+	uint64_t side[3];
+
+	ZobristTable() {
+		uint64_t x = 0x9E3779B97F4A7C15ULL;
+		auto next = [&x]() { // splitmix64
+			uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			return z ^ (z >> 31);
+		};
+		for (auto& sq : piece)
+			for (auto& key : sq) key = next();
+		for (auto& f : cover)
+			for (auto& key : f) key = next();
+		for (auto& key : side) key = next();
+	}
+};
+
+const ZobristTable zobrist;
+
+} // namespace
+
 void DarkChess_State::InitBoard() {
 	// 偶數(0 ~ 12): 帥 (K)、仕 (G)、相 (M)、俥 (R)、傌 (N)、炮 (C)、兵 (P)
 	// 奇數(1 ~ 13): 將 (k)、士 (g)、象 (m)、車 (r)、馬 (n)、包 (c)、卒 (p)
@@ -23,6 +55,68 @@ void DarkChess_State::InitBoard() {
 	}
 }
 
+void DarkChess_State::InitBoard(const FIN board[BOARD_SIZE],
+                                const int cover[14]) {
+	time[RED] = 0;
+	time[BLK] = 0;
+	memcpy(this->board, board, sizeof(FIN) * BOARD_SIZE);
+	memcpy(coverPieceCount, cover, sizeof(int) * 14);
+	act_history.clear();
+
+	// 剩餘數量 = 盤面上的數量 + 未翻開的數量
+	memset(chess_count, 0, sizeof(int) * 16);
+	for (int sq = 0; sq < BOARD_SIZE; sq++) {
+		chess_count[board[sq]]++;
+	}
+	for (int i = 0; i < 14; i++) {
+		chess_count[i] += cover[i];
+	}
+}
+
+namespace {
+
+// PackedState::covers 中各類暗子數量的位移與位元數
+const int COVER_SHIFT[14] = {0, 1, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 25};
+const int COVER_BITS[14] = {1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3};
+
+}  // namespace
+
+PackedState DarkChess_State::pack() const {
+	PackedState packed;
+	packed.board[0] = packed.board[1] = 0;
+	for (int sq = 0; sq < BOARD_SIZE; sq++) {
+		packed.board[sq >> 4] |= (uint64_t)board[sq] << ((sq & 15) * 4);
+	}
+	packed.covers = 0;
+	for (int i = 0; i < 14; i++) {
+		packed.covers |= (uint32_t)coverPieceCount[i] << COVER_SHIFT[i];
+	}
+	packed.header = (uint32_t)curr_player | (uint32_t)my_color << 2 |
+	                (uint32_t)winner << 4 |
+	                (uint32_t)std::min(no_eat_flip, 255) << 6 |
+	                (uint32_t)(last_action.getActionID() + 1) << 14 |
+	                (uint32_t)last_action.getPlayer() << 23;
+	return packed;
+}
+
+void DarkChess_State::unpack(const PackedState& packed) {
+	FIN fins[BOARD_SIZE];
+	int cover[14];
+	for (int sq = 0; sq < BOARD_SIZE; sq++) fins[sq] = FIN(packed.getPiece(sq));
+	for (int i = 0; i < 14; i++) {
+		cover[i] = (packed.covers >> COVER_SHIFT[i]) & ((1 << COVER_BITS[i]) - 1);
+	}
+	InitBoard(fins, cover);
+
+	curr_player = packed.header & 3;
+	my_color = (packed.header >> 2) & 3;
+	opp_color = my_color == UNKNOWN ? UNKNOWN : (my_color == RED ? BLK : RED);
+	winner = (packed.header >> 4) & 3;
+	no_eat_flip = packed.getNoEatFlip();
+	last_action = DarkChess_Action((packed.header >> 23) & 3,
+	                               (int)((packed.header >> 14) & 0x1FF) - 1);
+}
+
 bool DarkChess_State::isLegalAction(DarkChess_Action action) const {
 	int from = ActionMap[action.getActionID()].first;
 	int to = ActionMap[action.getActionID()].second;
@@ -38,36 +132,23 @@ bool DarkChess_State::isLegalAction(DarkChess_Action action) const {
 		else if (src_chess == FIN_COVER || src_chess == FIN_EMPTY ||
 		         dst_chess == FIN_COVER) {
 			return false;
-		} else if (action.getPlayer() == COLOR::RED) { // 紅棋
-			// 起點需為紅棋，終點需為黑棋或空格
-			if (color_of(src_chess) && dst_chess == FIN_EMPTY &&
-			    isNeighbor(action)) {
-				return true; // 終點是空格可以直接移動
-			} else if (color_of(src_chess) != COLOR::BLK ||
-			           color_of(dst_chess) != COLOR::RED) {
-				return false;
-			} else if (src_chess == FIN_C) { // 炮要特殊判定
-				return checkCannonCanEat(action);
-			} else if (!isNeighbor(action)) {
-				return false;
-			} else if (!can_capture(src_chess, dst_chess)) {
-				return false;
-			}
-		} else if (action.getPlayer() == COLOR::BLK) { // 黑棋
-			// 起點需為黑棋，終點需為紅棋或空格
-			if (color_of(src_chess) && dst_chess == FIN_EMPTY &&
-			    isNeighbor(action)) {
-				return true; // 終點是空格可以直接移動
-			} else if (color_of(src_chess) != COLOR::RED ||
-			           color_of(dst_chess) != COLOR::BLK) {
-				return false;
-			} else if (src_chess == FIN_C) { // 炮要特殊判定
-				return checkCannonCanEat(action);
-			} else if (!isNeighbor(action)) {
-				return false;
-			} else if (!can_capture(src_chess, dst_chess)) {
-				return false;
-			}
+		}
+
+		// action 的 player 為上一手的玩家，這一手由另一方的棋子移動
+		int mover = (action.getPlayer() == COLOR::RED) ? COLOR::BLK : COLOR::RED;
+		// 起點需為己方棋子，終點需為空格或對方棋子
+		if (color_of(src_chess) == mover && dst_chess == FIN_EMPTY &&
+		    isNeighbor(action)) {
+			return true; // 終點是空格可以直接移動
+		} else if (color_of(src_chess) != mover ||
+		           color_of(dst_chess) != action.getPlayer()) {
+			return false;
+		} else if (type_of(src_chess) == FIN_C) { // 炮要特殊判定
+			return checkCannonCanEat(action);
+		} else if (!isNeighbor(action)) {
+			return false;
+		} else if (!can_capture(src_chess, dst_chess)) {
+			return false;
 		}
 	} else {
 		if (src_chess != FIN_COVER) { // 要翻開的那格只能是暗子
@@ -90,6 +171,11 @@ std::vector<DarkChess_Action> DarkChess_State::getAvailableActions() const {
 }
 
 DarkChess_State DarkChess_State::applyAction(DarkChess_Action action) {
+	return applyAction(action, random_);
+}
+
+DarkChess_State DarkChess_State::applyAction(DarkChess_Action action,
+                                             std::mt19937& rng) const {
 	DarkChess_State next_state(*this);
 	int from = ActionMap[action.getActionID()].first;
 	int to = ActionMap[action.getActionID()].second;
@@ -108,7 +194,7 @@ DarkChess_State DarkChess_State::applyAction(DarkChess_Action action) {
 			next_state.no_eat_flip++;
 		}
 	} else { // 翻棋
-		int chess_id = getRandomChessId();
+		int chess_id = getRandomChessId(rng);
 		FIN FIN_FLIP = FIN(chess_id);
 
 		next_state.board[to] = FIN_FLIP;
@@ -117,7 +203,7 @@ DarkChess_State DarkChess_State::applyAction(DarkChess_Action action) {
 		next_state.no_eat_flip = 0;
 
 		if (action.getPlayer() == UNKNOWN) {
-			next_state.curr_player = (color_of(FIN_FLIP) == RED) ? BLK : RED;
+			next_state.curr_player = color_of(FIN_FLIP);
 			next_state.my_color = color_of(FIN_FLIP);
 			next_state.opp_color = (color_of(FIN_FLIP) == RED) ? BLK : RED;
 		} else {
@@ -128,12 +214,34 @@ DarkChess_State DarkChess_State::applyAction(DarkChess_Action action) {
 	next_state.act_history.push_back(action);
 
 	if (next_state.getAvailableActions().size() == 0) {
-		next_state.winner = (curr_player == RED) ? BLK : RED;
+		next_state.winner = next_state.curr_player;
 	}
 
 	return next_state;
 }
 
+uint64_t DarkChess_State::getHash(int side_to_move) const {
+	uint64_t hash = zobrist.side[side_to_move];
+	for (int sq = 0; sq < BOARD_SIZE; sq++) {
+		hash ^= zobrist.piece[sq][board[sq]];
+	}
+	for (int i = 0; i < 14; i++) {
+		hash ^= zobrist.cover[i][coverPieceCount[i]];
+	}
+	return hash;
+}
+
+uint64_t DarkChess_State::getHash(int side_to_move, int symmetry) const {
+	uint64_t hash = zobrist.side[side_to_move];
+	for (int sq = 0; sq < BOARD_SIZE; sq++) {
+		hash ^= zobrist.piece[transformSquare(sq, symmetry)][board[sq]];
+	}
+	for (int i = 0; i < 14; i++) {
+		hash ^= zobrist.cover[i][coverPieceCount[i]];
+	}
+	return hash;
+}
+
 bool DarkChess_State::isNeighbor(DarkChess_Action action) const {
 	int from = ActionMap[action.getActionID()].first;
 	int to = ActionMap[action.getActionID()].second;
@@ -178,9 +286,11 @@ bool DarkChess_State::checkCannonCanEat(DarkChess_Action action) const {
 	return (chess_cnt == 1);
 }
 
-int DarkChess_State::getRandomChessId() {
+int DarkChess_State::getRandomChessId() { return getRandomChessId(random_); }
+
+int DarkChess_State::getRandomChessId(std::mt19937& rng) const {
 	int rand_num =
-	    std::uniform_int_distribution<int>{0, chess_count[14] - 1}(random_);
+	    std::uniform_int_distribution<int>{0, chess_count[14] - 1}(rng);
 	int rand_chess_id = 0;
 	for (int i = 0; i <= 13; i++) {
 		rand_num -= coverPieceCount[i];
@@ -198,8 +308,9 @@ bool DarkChess_State::isTerminal() const {
 	// 超過一定步數無吃翻
 	if (no_eat_flip >= NO_EAT_FLIP_LIMIT) return true;
 
-	// 長捉 (4 步一循環)
-	if (no_eat_flip >= LONG_CATCH_LIMIT * 4) {
+	// 長捉 (4 步一循環)，由快照還原的局面可能沒有足夠的歷史動作
+	if (no_eat_flip >= LONG_CATCH_LIMIT * 4 &&
+	    act_history.size() >= LONG_CATCH_LIMIT * 4) {
 		int act_hist_size = act_history.size();
 		// 循環的 4 步
 		int act1 = act_history[act_hist_size - 1].getActionID();
@@ -0,0 +1,79 @@
+#include "MoveGen.h"
+
+namespace {
+
+struct MoveTables {
+	int neighbors[BOARD_SIZE][4];
+	int action_index[BOARD_SIZE][BOARD_SIZE];
+
+	MoveTables() {
+		for (int sq = 0; sq < BOARD_SIZE; sq++) {
+			int col = sq / ROW_COUNT, row = sq % ROW_COUNT;
+			neighbors[sq][0] = row + 1 < ROW_COUNT ? sq + 1 : -1;
+			neighbors[sq][1] = row > 0 ? sq - 1 : -1;
+			neighbors[sq][2] = col > 0 ? sq - ROW_COUNT : -1;
+			neighbors[sq][3] = col + 1 < COL_COUNT ? sq + ROW_COUNT : -1;
+		}
+		for (auto& from : action_index)
+			for (auto& id : from) id = -1;
+		for (int i = 0; i < ACTION_SIZE; i++) {
+			action_index[ActionMap[i].first][ActionMap[i].second] = i;
+		}
+	}
+};
+
+const MoveTables tables;
+
+} // namespace
+
+const int* neighborsOf(int sq) { return tables.neighbors[sq]; }
+
+int actionIndex(int from, int to) { return tables.action_index[from][to]; }
+
+int cannonTargets(const FIN board[BOARD_SIZE], int from, int targets[4]) {
+	int n = 0;
+	for (int dir = 0; dir < 4; dir++) {
+		bool screen = false;
+		for (int sq = tables.neighbors[from][dir]; sq != -1;
+		     sq = tables.neighbors[sq][dir]) {
+			if (board[sq] == FIN_EMPTY) continue;
+			if (screen) {
+				targets[n++] = sq;
+				break;
+			}
+			screen = true;
+		}
+	}
+	return n;
+}
+
+int generateMoves(const FIN board[BOARD_SIZE], int color, int* action_ids) {
+	int opp = (color == RED) ? BLK : RED;
+	int n = 0;
+	for (int from = 0; from < BOARD_SIZE; from++) {
+		FIN src = board[from];
+		if (color_of(src) != color) continue;
+
+		for (int dir = 0; dir < 4; dir++) {
+			int to = tables.neighbors[from][dir];
+			if (to == -1) continue;
+			FIN dst = board[to];
+			if (dst == FIN_EMPTY ||
+			    (type_of(src) != FIN_C && color_of(dst) == opp &&
+			     can_capture(src, dst))) {
+				action_ids[n++] = tables.action_index[from][to];
+			}
+		}
+
+		if (type_of(src) == FIN_C) {
+			int targets[4];
+			int count = cannonTargets(board, from, targets);
+			for (int i = 0; i < count; i++) {
+				if (color_of(board[targets[i]]) == opp) {
+					action_ids[n++] = tables.action_index[from][targets[i]];
+				}
+			}
+		}
+	}
+	return n;
+}
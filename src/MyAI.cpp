@@ -2,11 +2,28 @@
 
 #include <string.h>
 
+#include <algorithm>
+#include <chrono>
+
 #include "DarkChess.h"
 
 using namespace std;
 
-MyAI::MyAI() { InitBoard(); }
+MyAI::MyAI()
+    : deterministic(false),
+      seed(0),
+      simulation_count(40000),
+      thread_count(4),
+      pin_threads(false),
+      process_count(1),
+      time_budget(0),
+      heavy_playout(false),
+      search_stats(),
+      use_files(true),
+      endgame(new AlphaBeta()),
+      pool(new ThreadPool(thread_count, pin_threads)) {
+	InitBoard();
+}
 
 /*
  * Initial board
@@ -51,6 +68,9 @@ void MyAI::InitBoard(const char* data[]) {
 		coverPieceCount[i] = data[i + 32][0] - '0';
 		allCoverCount += coverPieceCount[i];
 	}
+
+	curr_state = DarkChess_State();
+	curr_state.InitBoard(board, coverPieceCount);
 }
 
 /*
@@ -100,6 +120,94 @@ void MyAI::SetColor(COLOR c) { color = c; }
 
 void MyAI::SetTime(COLOR c, int t) { time[c] = t; }
 
+/*
+ * Make every search reproducible: a fixed master seed, per-thread streams
+ * derived from it and a fixed playout count
+ *
+ * @param seed : the master seed of the search
+ */
+void MyAI::SetDeterministic(unsigned int seed) {
+	this->deterministic = true;
+	this->seed = seed;
+}
+
+void MyAI::SetSimulationCount(int count) { simulation_count = count; }
+
+void MyAI::SetThreadCount(int count) {
+	thread_count = std::max(1, count);
+	if (pool->size() != thread_count) pool.reset(new ThreadPool(thread_count, pin_threads));
+}
+
+/*
+ * Pin each search thread to its own CPU, starting from the first CPU the
+ * process may run on; only useful when a single engine owns the machine
+ * (or each engine is started under its own taskset)
+ *
+ * @param pin : true to pin the search threads
+ */
+void MyAI::SetPinThreads(bool pin) {
+	if (pin == pin_threads) return;
+	pin_threads = pin;
+	pool.reset(new ThreadPool(thread_count, pin_threads));
+}
+
+/*
+ * Limit the search time of each GenerateMove, the playout count still
+ * applies as an upper bound
+ *
+ * @param ms : the time budget in milliseconds, 0 for no limit
+ */
+void MyAI::SetTimeBudget(int ms) { time_budget = ms; }
+
+/*
+ * Spread every search over several processes forked from this one; the
+ * processes share root statistics and the endgame transposition table
+ * through anonymous shared memory
+ *
+ * @param count : the number of processes, each running thread_count threads
+ */
+void MyAI::SetProcessCount(int count) { process_count = std::max(1, count); }
+
+/*
+ * Choose the playout policy used when no value network is loaded
+ *
+ * @param name : "random" for uniform moves, "heavy" for moves weighted by
+ *               captures and threats
+ * @return false if the name is unknown
+ */
+bool MyAI::SetPlayout(const char* name) {
+	if (strcmp(name, "random") == 0) {
+		heavy_playout = false;
+	} else if (strcmp(name, "heavy") == 0) {
+		heavy_playout = true;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Map an opening book into memory
+ *
+ * @param path : the book file built by tools/book_builder
+ */
+bool MyAI::LoadBook(const char* path) { return book.load(path); }
+
+/*
+ * Map every endgame tablebase file in a directory into memory
+ *
+ * @param dir : the directory written by tools/tb_generator
+ * @return the number of tables loaded
+ */
+int MyAI::LoadTablebase(const char* dir) { return tablebase.load(dir); }
+
+/*
+ * Load the value network used in place of random playouts
+ *
+ * @param path : the weight file written by tools/vnet_trainer
+ */
+bool MyAI::LoadValueNet(const char* path) { return value_net.load(path); }
+
 /*
  * Generate the best move of current player
  * This function will choose a random move so you may want to modify this.
@@ -107,27 +215,273 @@ void MyAI::SetTime(COLOR c, int t) { time[c] = t; }
  * TODO: your work here
  */
 MOVE MyAI::GenerateMove(int curr_color) {
+	TRACE_SCOPE(TRACE_GENMOVE);
 	if (curr_state.getMyColor() == COLOR::UNKNOWN) {
-		curr_state.setCurrPlayer(curr_color);
+		// 對手先翻棋時，上一手的玩家為對方
+		if (curr_color != COLOR::UNKNOWN) {
+			curr_state.setCurrPlayer((curr_color == RED) ? BLK : RED);
+		}
 
 		curr_state.setMyColor(curr_color);
 		curr_state.setOppColor((curr_color == RED) ? BLK : RED);
 	}
 
-	std::random_device rd;
-	std::mt19937 rng(rd());
+	search_stats = SearchStats();
+	auto start = std::chrono::steady_clock::now();
+
+	// 局面仍在開局庫內時直接回傳，不進行搜尋；開局庫以標準方向保存
+	int book_action, symmetry;
+	uint64_t book_key = canonicalHash(curr_state, curr_color, symmetry);
+	if (use_files && book.probe(book_key, book_action)) {
+		book_action = transformAction(book_action, symmetry);
+		if (curr_state.isLegalAction(
+		        DarkChess_Action(curr_state.getCurrColor(), book_action))) {
+			search_stats.book_hit = true;
+			return make_move(ActionMap[book_action].first,
+			                 ActionMap[book_action].second);
+		}
+	}
 
+	// 沒有暗子後已沒有機率事件，改用 alpha-beta
+	if (AlphaBeta::applies(curr_state)) {
+		endgame->time_limit = time_budget;
+		endgame->node_limit =
+		    time_budget > 0 ? 0 : (long)simulation_count * AB_NODES_PER_PLAYOUT;
+		endgame->tablebase = use_files && tablebase.isLoaded() ? &tablebase : nullptr;
+
+		// 其他行程以錯開的起始深度同時搜尋，經由共享的置換表互相利用結果
+		// (Lazy SMP)；結果與時序有關，確定性模式下不使用
+		SharedArray<std::atomic<int>> stop(process_count > 1 && !deterministic ? 1 : 0);
+		std::vector<pid_t> helpers;
+		if (stop.size() > 0) {
+			helpers = forkWorkers(process_count - 1, [&](int worker) {
+				endgame->start_depth = 1 + worker % 2;
+				endgame->time_limit = 0;
+				endgame->node_limit = 0;
+				endgame->stop_flag = stop.data();
+				endgame->search(curr_state);
+			});
+		}
+		int action_id = endgame->search(curr_state);
+		if (stop.size() > 0) {
+			stop[0].store(1);
+			int failed = waitWorkers(helpers);
+			if (failed > 0) {
+				fprintf(stderr, "warning: %d of %zu endgame helper processes failed\n",
+				        failed, helpers.size());
+			}
+		}
+
+		if (action_id >= 0) {
+			search_stats.nodes = endgame->nodes;
+			search_stats.depth = endgame->depth;
+			search_stats.elapsed_ms = std::chrono::duration<double, std::milli>(
+			                              std::chrono::steady_clock::now() - start)
+			                              .count();
+			return make_move(ActionMap[action_id].first, ActionMap[action_id].second);
+		}
+	}
+
+	std::mt19937 rng;
+	if (!deterministic) {
+		std::random_device rd;
+		rng.seed(rd());
+	}
+
+	// 互為鏡像的動作只搜尋其中一個
 	std::vector<DarkChess_Action> actions = curr_state.getAvailableActions();
-	MCTS<DarkChess_State, DarkChess_Action> mcts(curr_state, actions);
+	dedupeSymmetricActions(curr_state, actions);
+
+	// 多個行程時每個行程各自建樹 (root parallelization)，模擬次數平均分配，
+	// 結束時把根節點統計加進共享記憶體，由這個行程合併後選出最多訪問的動作
+	int procs = std::max(1, process_count);
+	SharedArray<SharedRootStats> shared(procs > 1 ? 1 : 0);
+	if (shared.size() == 0) procs = 1;
+
+	auto search = [&](int worker, ThreadPool* search_pool, std::mt19937& search_rng) {
+		SearchTree mcts(curr_state, actions);
+		mcts.simulation_count =
+		    simulation_count / procs + (worker < simulation_count % procs ? 1 : 0);
+		mcts.thread_count = thread_count;
+		mcts.deterministic = deterministic;
+		mcts.seed = seed + worker * 0x9E3779B9U;
+		mcts.time_limit = time_budget;
+		mcts.pool = search_pool;
+		mcts.prune_actions = dedupeSymmetricActions;
+		if (use_files && tablebase.isLoaded()) {
+			mcts.exact_value = [this](const DarkChess_State& state, double& value) {
+				return tablebase.probe(state, value);
+			};
+		}
+		ValueBatcher batcher(value_net, thread_count, VNET_BATCH_TIMEOUT_US);
+		mcts.playout.heavy = heavy_playout;
+		if (use_files && value_net.isLoaded()) {
+			mcts.playout.net = &value_net;
+			if (thread_count > 1) mcts.playout.batcher = &batcher;
+		}
+
+		DarkChess_Action best = mcts.run(search_rng);
+		if (procs > 1) shared[0].add(mcts.rootStats(), mcts.playouts, mcts.nodes);
+		search_stats.playouts = mcts.playouts;
+		search_stats.nodes = mcts.nodes;
+		return best;
+	};
+
+	std::vector<pid_t> workers;
+	if (procs > 1) {
+		unsigned int base = rng();
+		workers = forkWorkers(procs - 1, [&](int worker) {
+			// 父行程的 ThreadPool 線程不會被複製，子行程建立自己的（不綁定核心）
+			std::unique_ptr<ThreadPool> worker_pool(
+			    thread_count > 1 ? new ThreadPool(thread_count, false) : nullptr);
+			std::seed_seq seq{base, static_cast<unsigned int>(worker)};
+			std::mt19937 worker_rng(seq);
+			search(worker, worker_pool.get(), worker_rng);
+		});
+	}
+	DarkChess_Action best_action = search(0, pool.get(), rng);
+	if (procs > 1) {
+		// 失敗的行程沒有加入統計，playouts/nodes 只反映完成的部分
+		int failed = waitWorkers(workers);
+		if (failed > 0) {
+			fprintf(stderr, "warning: %d of %zu search processes failed, their playouts are lost\n",
+			        failed, workers.size());
+		}
+		int best_id = shared[0].best();
+		if (best_id >= 0) best_action = DarkChess_Action(curr_state.getCurrColor(), best_id);
+		search_stats.playouts = shared[0].playouts.load();
+		search_stats.nodes = shared[0].nodes.load();
+	}
 
-	DarkChess_Action best_action = mcts.run(rng);
+	search_stats.elapsed_ms = std::chrono::duration<double, std::milli>(
+	                              std::chrono::steady_clock::now() - start)
+	                              .count();
 	int action_id = best_action.getActionID();
+	if (action_id < 0) return MOVE_NULL; // 沒有合法動作，認輸
 	int from = ActionMap[action_id].first;
 	int to = ActionMap[action_id].second;
 
 	return make_move(from, to);
 }
 
+// 內建 bench 的局面：名稱、輪到的一方、a1..a8 b1..b8 c1..c8 d1..d8 順序的盤面、
+// 各類暗子的數量；建置時由 bench/positions.txt 產生，與 bin/bench 共用同一份 corpus
+static const char* BENCH_POSITIONS[][4] = {
+#include "bench_positions.inc"
+};
+
+/*
+ * Search a fixed set of positions with a fixed seed and playout budget,
+ * print one line per position to stderr and restore the game in progress
+ *
+ * @param playouts : the playout budget per position, 0 for BENCH_PLAYOUTS
+ * @return a summary with the total playouts, time, playouts/s and a
+ *         signature of the chosen moves and search sizes; the signature
+ *         depends on the playout budget and policy and the process and thread
+ *         counts; the opening book, tablebases and value network are not used
+ *         so it does not depend on the files loaded, and the game's endgame
+ *         transposition table is left untouched
+ */
+string MyAI::Bench(int playouts) {
+	if (playouts <= 0) playouts = BENCH_PLAYOUTS;
+
+	// 保存目前的對局與搜尋設定
+	int saved_color = color;
+	int saved_time[2] = {time[RED], time[BLK]};
+	FIN saved_board[BOARD_SIZE];
+	int saved_cover[14];
+	memcpy(saved_board, board, sizeof(board));
+	memcpy(saved_cover, coverPieceCount, sizeof(coverPieceCount));
+	int saved_all_cover = allCoverCount;
+	DarkChess_State saved_state(curr_state);
+	bool saved_deterministic = deterministic;
+	unsigned int saved_seed = seed;
+	int saved_simulation_count = simulation_count;
+	int saved_time_budget = time_budget;
+
+	SetDeterministic(BENCH_SEED);
+	simulation_count = playouts;
+	time_budget = 0;
+	// 不使用載入的檔案；alpha-beta 用新的置換表，不影響對局中的置換表
+	bool saved_use_files = use_files;
+	use_files = false;
+	std::unique_ptr<AlphaBeta> saved_endgame(new AlphaBeta());
+	endgame.swap(saved_endgame);
+
+	long total_playouts = 0, total_nodes = 0;
+	double total_ms = 0, mcts_ms = 0; // 模擬速度只計 MCTS 的局面
+	uint64_t signature = 0xCBF29CE484222325ULL; // FNV-1a
+	auto mix = [&signature](long value) {
+		for (int i = 0; i < 8; i++) {
+			signature ^= (value >> (i * 8)) & 0xFF;
+			signature *= 0x100000001B3ULL;
+		}
+	};
+
+	for (const auto& pos : BENCH_POSITIONS) {
+		color = strcmp(pos[1], "red") == 0     ? RED
+		        : strcmp(pos[1], "black") == 0 ? BLK
+		                                       : UNKNOWN;
+		allCoverCount = 0;
+		for (int sq = 0; sq < BOARD_SIZE; sq++) board[sq] = char2fin(pos[2][sq]);
+		for (int i = 0; i < 14; i++) {
+			coverPieceCount[i] = pos[3][i] - '0';
+			allCoverCount += coverPieceCount[i];
+		}
+		curr_state = DarkChess_State();
+		curr_state.InitBoard(board, coverPieceCount);
+		if (color != UNKNOWN) {
+			int opp = (color == RED) ? BLK : RED;
+			curr_state.setCurrPlayer(opp);
+			curr_state.setMyColor(color);
+			curr_state.setOppColor(opp);
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		MOVE move = GenerateMove(color);
+		double ms = std::chrono::duration<double, std::milli>(
+		                std::chrono::steady_clock::now() - start)
+		                .count();
+
+		total_playouts += search_stats.playouts;
+		total_nodes += search_stats.nodes;
+		total_ms += ms;
+		if (search_stats.playouts > 0) mcts_ms += ms;
+		mix(move);
+		mix(search_stats.playouts);
+		mix(search_stats.nodes);
+		mix(search_stats.depth);
+		fprintf(stderr, "bench %-10s %s %6d playouts %9d nodes depth %2d %9.1f ms\n",
+		        pos[0], to_string(move).c_str(), search_stats.playouts,
+		        search_stats.nodes, search_stats.depth, ms);
+	}
+
+	// 還原對局與搜尋設定
+	color = saved_color;
+	time[RED] = saved_time[0];
+	time[BLK] = saved_time[1];
+	memcpy(board, saved_board, sizeof(board));
+	memcpy(coverPieceCount, saved_cover, sizeof(coverPieceCount));
+	allCoverCount = saved_all_cover;
+	curr_state = saved_state;
+	deterministic = saved_deterministic;
+	seed = saved_seed;
+	simulation_count = saved_simulation_count;
+	use_files = saved_use_files;
+	endgame.swap(saved_endgame);
+	time_budget = saved_time_budget;
+
+	char summary[256];
+	snprintf(summary, sizeof(summary),
+	         "%zu positions, %d processes, %d threads, %ld playouts, %ld nodes, %.1f ms, "
+	         "%.0f playouts/s, signature %016llx",
+	         sizeof(BENCH_POSITIONS) / sizeof(BENCH_POSITIONS[0]), process_count, thread_count,
+	         total_playouts, total_nodes, total_ms,
+	         mcts_ms > 0 ? total_playouts * 1000.0 / mcts_ms : 0.0,
+	         (unsigned long long)signature);
+	return summary;
+}
+
 string MyAI::GetProtocolVersion() const { return "1.1.0"; }
 
 string MyAI::GetAIName() const { return "MyAI"; }
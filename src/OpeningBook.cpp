@@ -0,0 +1,110 @@
+#include "OpeningBook.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+static const char BOOK_MAGIC[8] = {'C', 'D', 'C', 'B', 'O', 'O', 'K', '1'};
+
+bool OpeningBook::load(const char* path) {
+	unload();
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(BookHeader)) {
+		close(fd);
+		return false;
+	}
+
+	void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) return false;
+
+	const BookHeader* header = static_cast<const BookHeader*>(addr);
+	size_t expect = sizeof(BookHeader) + (size_t)header->count * sizeof(BookEntry);
+	if (memcmp(header->magic, BOOK_MAGIC, sizeof(BOOK_MAGIC)) != 0 ||
+	    header->version != VERSION || (size_t)st.st_size != expect) {
+		munmap(addr, st.st_size);
+		return false;
+	}
+
+	mapping = addr;
+	mapping_size = st.st_size;
+	count = header->count;
+	entries = reinterpret_cast<const BookEntry*>(header + 1);
+	return true;
+}
+
+void OpeningBook::unload() {
+	if (mapping != nullptr) {
+		munmap(mapping, mapping_size);
+	}
+	mapping = nullptr;
+	mapping_size = 0;
+	entries = nullptr;
+	count = 0;
+}
+
+bool OpeningBook::probe(uint64_t key, int& action_id) const {
+	if (entries == nullptr) return false;
+
+	const BookEntry* first = std::lower_bound(
+	    entries, entries + count, key,
+	    [](const BookEntry& e, uint64_t k) { return e.key < k; });
+
+	// 同一局面的動作相鄰存放，取訪問次數最多者
+	const BookEntry* best = nullptr;
+	for (const BookEntry* e = first; e != entries + count && e->key == key; e++) {
+		if (best == nullptr || e->visits > best->visits) best = e;
+	}
+	if (best == nullptr || best->visits < (uint32_t)min_visits) return false;
+
+	action_id = best->action_id;
+	return true;
+}
+
+bool OpeningBook::write(const char* path, std::vector<BookEntry>& entries) {
+	std::sort(entries.begin(), entries.end(),
+	          [](const BookEntry& a, const BookEntry& b) {
+		          return a.key != b.key ? a.key < b.key : a.action_id < b.action_id;
+	          });
+
+	// 合併相同 (key, action_id)，score 以訪問次數加權平均
+	std::vector<BookEntry> merged;
+	for (const BookEntry& e : entries) {
+		if (!merged.empty() && merged.back().key == e.key &&
+		    merged.back().action_id == e.action_id) {
+			BookEntry& m = merged.back();
+			double total = (double)m.visits + e.visits;
+			if (total > 0) {
+				m.score = (float)((m.score * m.visits + e.score * e.visits) / total);
+			}
+			m.visits += e.visits;
+		} else {
+			merged.push_back(e);
+			memset(merged.back().reserved, 0, sizeof(e.reserved));
+		}
+	}
+	entries.swap(merged);
+
+	FILE* fp = fopen(path, "wb");
+	if (fp == NULL) return false;
+
+	BookHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+	header.version = VERSION;
+	header.count = entries.size();
+
+	bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+	          fwrite(entries.data(), sizeof(BookEntry), entries.size(), fp) ==
+	              entries.size();
+	return fclose(fp) == 0 && ok;
+}
@@ -0,0 +1,63 @@
+#include "SharedMemory.h"
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+void* mapShared(size_t bytes) {
+	void* addr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+	                  -1, 0);
+	return addr == MAP_FAILED ? nullptr : addr;
+}
+
+void unmapShared(void* addr, size_t bytes) { munmap(addr, bytes); }
+
+void SharedRootStats::add(const std::map<int, std::pair<int, double>>& stats,
+                          int playouts, int nodes) {
+	for (const auto& stat : stats) {
+		if (stat.first < 0 || stat.first >= ACTION_SIZE) continue;
+		visits[stat.first].fetch_add(stat.second.first, std::memory_order_relaxed);
+		wins[stat.first].fetch_add((int64_t)(stat.second.second * WIN_SCALE),
+		                           std::memory_order_relaxed);
+	}
+	this->playouts.fetch_add(playouts, std::memory_order_relaxed);
+	this->nodes.fetch_add(nodes, std::memory_order_relaxed);
+}
+
+int SharedRootStats::best() const {
+	int best_id = -1;
+	int64_t best_visits = 0;
+	for (int i = 0; i < ACTION_SIZE; i++) {
+		int64_t v = visits[i].load(std::memory_order_relaxed);
+		if (v > best_visits) {
+			best_visits = v;
+			best_id = i;
+		}
+	}
+	return best_id;
+}
+
+std::vector<pid_t> forkWorkers(int count, const std::function<void(int worker)>& fn) {
+	std::vector<pid_t> pids;
+	for (int worker = 1; worker <= count; worker++) {
+		pid_t pid = fork();
+		if (pid == 0) {
+			fn(worker);
+			_exit(0);
+		}
+		if (pid > 0) pids.push_back(pid);
+	}
+	return pids;
+}
+
+int waitWorkers(const std::vector<pid_t>& pids) {
+	int failed = 0;
+	for (pid_t pid : pids) {
+		int status;
+		if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+		    WEXITSTATUS(status) != 0) {
+			failed++;
+		}
+	}
+	return failed;
+}
@@ -0,0 +1,82 @@
+#include "Symmetry.h"
+
+#include <algorithm>
+
+#include "MoveGen.h"
+
+namespace {
+
+struct SymmetryTables {
+	int square[SYM_COUNT][BOARD_SIZE];
+	int action[SYM_COUNT][ACTION_SIZE];
+
+	SymmetryTables() {
+		for (int s = 0; s < SYM_COUNT; s++) {
+			for (int sq = 0; sq < BOARD_SIZE; sq++) {
+				int col = sq / ROW_COUNT, row = sq % ROW_COUNT;
+				if (s & 1) col = COL_COUNT - 1 - col;
+				if (s & 2) row = ROW_COUNT - 1 - row;
+				square[s][sq] = col * ROW_COUNT + row;
+			}
+			// 鏡射不改變相鄰與同一直線的關係，對應的動作必定存在
+			for (int i = 0; i < ACTION_SIZE; i++) {
+				action[s][i] = actionIndex(square[s][ActionMap[i].first],
+				                           square[s][ActionMap[i].second]);
+			}
+		}
+	}
+};
+
+const SymmetryTables tables;
+
+}  // namespace
+
+int transformSquare(int sq, int symmetry) { return tables.square[symmetry][sq]; }
+
+int transformAction(int action_id, int symmetry) {
+	return tables.action[symmetry][action_id];
+}
+
+int boardSymmetries(const DarkChess_State& state) {
+	int mask = 1 << SYM_IDENTITY;
+	for (int s = 1; s < SYM_COUNT; s++) {
+		bool same = true;
+		for (int sq = 0; sq < BOARD_SIZE && same; sq++) {
+			same = state.getPiece(sq) == state.getPiece(tables.square[s][sq]);
+		}
+		if (same) mask |= 1 << s;
+	}
+	return mask;
+}
+
+uint64_t canonicalHash(const DarkChess_State& state, int side_to_move, int& symmetry) {
+	uint64_t best = state.getHash(side_to_move);
+	symmetry = SYM_IDENTITY;
+	for (int s = 1; s < SYM_COUNT; s++) {
+		uint64_t hash = state.getHash(side_to_move, s);
+		if (hash < best) {
+			best = hash;
+			symmetry = s;
+		}
+	}
+	return best;
+}
+
+void dedupeSymmetricActions(const DarkChess_State& state,
+                            std::vector<DarkChess_Action>& actions) {
+	if (state.getNoEatFlip() >= LONG_CATCH_LIMIT * 4) return;
+	int mask = boardSymmetries(state);
+	if (mask == 1 << SYM_IDENTITY) return;
+
+	actions.erase(std::remove_if(actions.begin(), actions.end(),
+	                             [mask](const DarkChess_Action& action) {
+		                             int id = action.getActionID();
+		                             for (int s = 1; s < SYM_COUNT; s++) {
+			                             if ((mask >> s & 1) && transformAction(id, s) < id) {
+				                             return true;
+			                             }
+		                             }
+		                             return false;
+	                             }),
+	              actions.end());
+}
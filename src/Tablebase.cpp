@@ -0,0 +1,420 @@
+#include "Tablebase.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "MoveGen.h"
+
+static const char TB_MAGIC[8] = {'C', 'D', 'C', 'T', 'B', '0', '0', '1'};
+
+namespace {
+
+// 每種棋子的最大數量
+const int MAX_COUNT[14] = {1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 5, 5};
+
+// 二項式係數 C(n, k)
+struct Binomial {
+	uint64_t c[BOARD_SIZE + 1][Tablebase::MAX_PIECES + 1];
+
+	Binomial() {
+		for (int n = 0; n <= BOARD_SIZE; n++) {
+			for (int k = 0; k <= Tablebase::MAX_PIECES; k++) {
+				if (k == 0) c[n][k] = 1;
+				else if (n == 0) c[n][k] = 0;
+				else c[n][k] = c[n - 1][k - 1] + c[n - 1][k];
+			}
+		}
+	}
+};
+
+const Binomial binomial;
+
+// 子力組合：每種棋子的數量以 4 bits 存放
+uint64_t materialKey(const int count[14]) {
+	uint64_t key = 0;
+	for (int i = 0; i < 14; i++) {
+		key |= (uint64_t)count[i] << (i * 4);
+	}
+	return key;
+}
+
+// 盤面的子力組合，盤面有暗子時回傳 false
+bool boardMaterial(const FIN board[BOARD_SIZE], int count[14]) {
+	memset(count, 0, sizeof(int) * 14);
+	for (int sq = 0; sq < BOARD_SIZE; sq++) {
+		if (board[sq] == FIN_COVER) return false;
+		if (board[sq] != FIN_EMPTY) count[board[sq]]++;
+	}
+	return true;
+}
+
+std::string materialName(const int count[14]) {
+	std::string name;
+	for (int i = 0; i < 14; i++) {
+		name.append(count[i], "0123456789abcd"[i]);
+	}
+	return name;
+}
+
+// 擺法的完美雜湊：同種棋子為一組，依序以組合數系統編號，
+// 每組只在前面各組未佔用的格子中編號，因此不會有重複或空洞
+class Indexer {
+	public:
+		uint64_t placements;
+
+		explicit Indexer(const int count[14]) : placements(1), group_count(0) {
+			int used = 0;
+			for (int i = 0; i < 14; i++) {
+				if (count[i] == 0) continue;
+				type[group_count] = FIN(i);
+				size[group_count] = count[i];
+				radix[group_count] = binomial.c[BOARD_SIZE - used][count[i]];
+				placements *= radix[group_count];
+				used += count[i];
+				group_count++;
+			}
+		}
+
+		uint64_t rank(const FIN board[BOARD_SIZE]) const {
+			uint64_t idx = 0;
+			uint32_t mask = 0;
+			for (int g = 0; g < group_count; g++) {
+				uint64_t r = 0;
+				uint32_t group_mask = 0;
+				for (int sq = 0, k = 0; sq < BOARD_SIZE; sq++) {
+					if (board[sq] != type[g]) continue;
+					int compressed = sq - __builtin_popcount(mask & ((1u << sq) - 1));
+					r += binomial.c[compressed][++k];
+					group_mask |= 1u << sq;
+				}
+				idx = idx * radix[g] + r;
+				mask |= group_mask;
+			}
+			return idx;
+		}
+
+		void unrank(uint64_t idx, FIN board[BOARD_SIZE]) const {
+			uint64_t r[Tablebase::MAX_PIECES];
+			for (int g = group_count - 1; g >= 0; g--) {
+				r[g] = idx % radix[g];
+				idx /= radix[g];
+			}
+
+			for (int sq = 0; sq < BOARD_SIZE; sq++) board[sq] = FIN_EMPTY;
+
+			int used = 0;
+			for (int g = 0; g < group_count; g++) {
+				int free_count = BOARD_SIZE - used;
+				int compressed[Tablebase::MAX_PIECES];
+				uint64_t rem = r[g];
+				int c = free_count - 1;
+				for (int k = size[g]; k >= 1; k--) {
+					while (binomial.c[c][k] > rem) c--;
+					compressed[k - 1] = c;
+					rem -= binomial.c[c][k];
+					c--;
+				}
+				// 第 compressed 個尚未被前面各組佔用的格子
+				for (int k = 0, sq = 0, free_idx = 0; k < size[g]; sq++) {
+					if (board[sq] != FIN_EMPTY) continue;
+					if (free_idx++ == compressed[k]) {
+						board[sq] = type[g];
+						k++;
+					}
+				}
+				used += size[g];
+			}
+		}
+
+	private:
+		int group_count;
+		FIN type[Tablebase::MAX_PIECES];
+		int size[Tablebase::MAX_PIECES];
+		uint64_t radix[Tablebase::MAX_PIECES];
+};
+
+inline uint16_t entry(int wdl, int dtz) { return (uint16_t)((dtz << 2) | wdl); }
+
+typedef std::unordered_map<uint64_t, std::vector<uint16_t>> SolvedTables;
+
+// 吃子後的子局面在較小的表中的值（以被吃方為視角）
+uint16_t captureChild(const SolvedTables& solved, const FIN board[BOARD_SIZE],
+                      int opp) {
+	int count[14];
+	boardMaterial(board, count);
+	bool opp_alive = false;
+	for (int i = opp; i < 14; i += 2) {
+		if (count[i] > 0) opp_alive = true;
+	}
+	if (!opp_alive) return entry(TB_LOSS, 0);
+
+	Indexer indexer(count);
+	const std::vector<uint16_t>& table = solved.at(materialKey(count));
+	return table[opp * indexer.placements + indexer.rank(board)];
+}
+
+// 逆向分析：第 n 輪決定 dtz 為 n 的局面
+std::vector<uint16_t> solve(const int count[14], const SolvedTables& solved) {
+	const uint8_t WIN_CAPTURE = 1, SAFE_CAPTURE = 2;
+
+	Indexer indexer(count);
+	uint64_t n = indexer.placements;
+	std::vector<uint16_t> table(2 * n, 0);
+	std::vector<uint8_t> flags(2 * n, 0);
+
+	FIN board[BOARD_SIZE], child[BOARD_SIZE];
+	int moves[ACTION_SIZE];
+
+	// 無子可動為負；先計算吃子進入較小子力組合的結果
+	for (int side = RED; side <= BLK; side++) {
+		int opp = (side == RED) ? BLK : RED;
+		for (uint64_t idx = 0; idx < n; idx++) {
+			indexer.unrank(idx, board);
+			int move_count = generateMoves(board, side, moves);
+			if (move_count == 0) {
+				table[side * n + idx] = entry(TB_LOSS, 0);
+				continue;
+			}
+			for (int i = 0; i < move_count; i++) {
+				int from = ActionMap[moves[i]].first, to = ActionMap[moves[i]].second;
+				if (board[to] == FIN_EMPTY) continue;
+				memcpy(child, board, sizeof(child));
+				child[to] = child[from];
+				child[from] = FIN_EMPTY;
+				uint16_t value = captureChild(solved, child, opp);
+				if ((value & 3) == TB_LOSS) flags[side * n + idx] |= WIN_CAPTURE;
+				if ((value & 3) != TB_WIN) flags[side * n + idx] |= SAFE_CAPTURE;
+			}
+		}
+	}
+
+	for (int level = 1;; level++) {
+		bool changed = false;
+		for (int side = RED; side <= BLK; side++) {
+			int opp = (side == RED) ? BLK : RED;
+			for (uint64_t idx = 0; idx < n; idx++) {
+				if (table[side * n + idx] != 0) continue;
+
+				uint8_t flag = flags[side * n + idx];
+				bool win = level == 1 && (flag & WIN_CAPTURE);
+				bool all_lose = !(flag & SAFE_CAPTURE);
+
+				indexer.unrank(idx, board);
+				int move_count = generateMoves(board, side, moves);
+				for (int i = 0; i < move_count && !win; i++) {
+					int from = ActionMap[moves[i]].first, to = ActionMap[moves[i]].second;
+					if (board[to] != FIN_EMPTY) continue;
+					memcpy(child, board, sizeof(child));
+					child[to] = child[from];
+					child[from] = FIN_EMPTY;
+					uint16_t value = table[opp * n + indexer.rank(child)];
+					// 只採用前幾輪已決定的結果
+					if (value == 0 || (value >> 2) >= level) {
+						all_lose = false;
+					} else if ((value & 3) == TB_LOSS) {
+						win = true;
+					} else if ((value & 3) != TB_WIN) {
+						all_lose = false;
+					}
+				}
+
+				if (win) {
+					table[side * n + idx] = entry(TB_WIN, level);
+					changed = true;
+				} else if (all_lose) {
+					table[side * n + idx] = entry(TB_LOSS, level);
+					changed = true;
+				}
+			}
+		}
+		if (!changed) break;
+	}
+	return table;
+}
+
+// 列舉所有 pieces 子、雙方皆有子的子力組合
+void enumerateMaterials(int pieces, int type, int count[14],
+                        std::vector<std::vector<int>>& out) {
+	if (type == 14) {
+		if (pieces != 0) return;
+		bool red = false, black = false;
+		for (int i = 0; i < 14; i++) {
+			if (count[i] > 0) (i % 2 == RED ? red : black) = true;
+		}
+		if (red && black) out.push_back(std::vector<int>(count, count + 14));
+		return;
+	}
+	for (int c = 0; c <= MAX_COUNT[type] && c <= pieces; c++) {
+		count[type] = c;
+		enumerateMaterials(pieces - c, type + 1, count, out);
+	}
+	count[type] = 0;
+}
+
+// 最後 4 步與再之前的 4 步相同：雙方正在重複同一個循環，可能形成長捉
+bool inChaseCycle(const DarkChess_State& state) {
+	const std::vector<DarkChess_Action>& history = state.getHistory();
+	int size = history.size();
+	if (state.getNoEatFlip() < 8 || size < 8) return false;
+	for (int k = 1; k <= 4; k++) {
+		if (history[size - k].getActionID() != history[size - k - 4].getActionID()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+int Tablebase::load(const char* dir) {
+	unload();
+
+	DIR* dp = opendir(dir);
+	if (dp == NULL) return 0;
+
+	struct dirent* ent;
+	while ((ent = readdir(dp)) != NULL) {
+		size_t len = strlen(ent->d_name);
+		if (len < 4 || strcmp(ent->d_name + len - 3, ".tb") != 0) continue;
+
+		std::string path = std::string(dir) + "/" + ent->d_name;
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) continue;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(TablebaseHeader)) {
+			close(fd);
+			continue;
+		}
+		void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (addr == MAP_FAILED) continue;
+
+		const TablebaseHeader* header = static_cast<const TablebaseHeader*>(addr);
+		int count[14] = {0};
+		bool valid = memcmp(header->magic, TB_MAGIC, sizeof(TB_MAGIC)) == 0 &&
+		             header->version == VERSION &&
+		             header->piece_count <= (uint32_t)MAX_PIECES &&
+		             (size_t)st.st_size == sizeof(TablebaseHeader) +
+		                 2 * header->placements * sizeof(uint16_t);
+		for (uint32_t i = 0; valid && i < header->piece_count; i++) {
+			if (header->pieces[i] >= 14) valid = false;
+			else count[header->pieces[i]]++;
+		}
+		if (!valid || Indexer(count).placements != header->placements) {
+			munmap(addr, st.st_size);
+			continue;
+		}
+
+		Table table;
+		table.mapping = addr;
+		table.mapping_size = st.st_size;
+		table.entries = reinterpret_cast<const uint16_t*>(header + 1);
+		table.placements = header->placements;
+		tables[materialKey(count)] = table;
+		if ((int)header->piece_count > max_pieces) max_pieces = header->piece_count;
+	}
+	closedir(dp);
+	return tables.size();
+}
+
+void Tablebase::unload() {
+	for (auto& entry : tables) {
+		munmap(entry.second.mapping, entry.second.mapping_size);
+	}
+	tables.clear();
+	max_pieces = 0;
+}
+
+bool Tablebase::probe(const FIN board[BOARD_SIZE], int side_to_move, int& result,
+                      int& dtz) const {
+	int count[14];
+	if (!boardMaterial(board, count)) return false;
+
+	auto it = tables.find(materialKey(count));
+	if (it == tables.end()) return false;
+
+	Indexer indexer(count);
+	uint16_t value =
+	    it->second.entries[side_to_move * it->second.placements + indexer.rank(board)];
+	result = (value & 3) == TB_WIN ? 1 : (value & 3) == TB_LOSS ? -1 : 0;
+	dtz = value >> 2;
+	return true;
+}
+
+bool Tablebase::probe(const DarkChess_State& state, double& value) const {
+	if (tables.empty() || state.getChessCount(FIN_COVER) != 0) return false;
+
+	int side_to_move = state.getSideToMove();
+	if (side_to_move == UNKNOWN) return false;
+	// 表中不含歷史動作，已在循環中的局面可能因長捉而成為和局
+	if (inChaseCycle(state)) return false;
+
+	int pieces = 0;
+	FIN board[BOARD_SIZE];
+	for (int sq = 0; sq < BOARD_SIZE; sq++) {
+		board[sq] = state.getPiece(sq);
+		if (board[sq] != FIN_EMPTY && ++pieces > max_pieces) return false;
+	}
+
+	int result, dtz;
+	if (!probe(board, side_to_move, result, dtz)) return false;
+	// 勝負需在無吃翻步數限制內分出，否則實際為和局
+	if (result != 0 && !withinNoEatFlip(state.getNoEatFlip(), dtz)) return false;
+
+	value = (side_to_move == state.getMyColor()) ? result : -result;
+	return true;
+}
+
+bool Tablebase::generate(const char* dir, int max_pieces, FILE* log) {
+	if (max_pieces > MAX_PIECES) return false;
+
+	SolvedTables solved;
+	for (int pieces = 2; pieces <= max_pieces; pieces++) {
+		int count[14] = {0};
+		std::vector<std::vector<int>> materials;
+		enumerateMaterials(pieces, 0, count, materials);
+
+		for (const auto& material : materials) {
+			std::vector<uint16_t> table = solve(material.data(), solved);
+
+			TablebaseHeader header;
+			memset(&header, 0, sizeof(header));
+			memcpy(header.magic, TB_MAGIC, sizeof(TB_MAGIC));
+			header.version = VERSION;
+			header.piece_count = pieces;
+			for (int i = 0, k = 0; i < 14; i++) {
+				for (int c = 0; c < material[i]; c++) header.pieces[k++] = i;
+			}
+			header.placements = table.size() / 2;
+
+			std::string name = materialName(material.data());
+			std::string path = std::string(dir) + "/" + name + ".tb";
+			FILE* fp = fopen(path.c_str(), "wb");
+			if (fp == NULL) return false;
+			bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+			          fwrite(table.data(), sizeof(uint16_t), table.size(), fp) ==
+			              table.size();
+			if (fclose(fp) != 0 || !ok) return false;
+
+			if (log != NULL) {
+				uint64_t win = 0, loss = 0;
+				for (uint16_t v : table) {
+					if ((v & 3) == TB_WIN) win++;
+					if ((v & 3) == TB_LOSS) loss++;
+				}
+				fprintf(log, "%s: %zu positions, %llu win, %llu loss\n", name.c_str(),
+				        table.size(), (unsigned long long)win,
+				        (unsigned long long)loss);
+			}
+			solved[materialKey(material.data())].swap(table);
+		}
+	}
+	return true;
+}
@@ -0,0 +1,207 @@
+#include "Tactics.h"
+
+#include <string.h>
+
+#include <cmath>
+
+#include "MoveGen.h"
+
+namespace {
+
+//                           K    G    M    R     N    C    P
+const double PIECE_VALUE[7] = {1.0, 0.6, 0.3, 0.2, 0.15, 0.4, 0.1};
+
+// CAPTURERS[t] 的第 a 位：a 種棋子能吃 t 種棋子（炮/包翻山可吃任何棋子）
+struct CaptureTable {
+	uint8_t capturers[7];
+
+	CaptureTable() {
+		for (int victim = 0; victim < 7; victim++) {
+			capturers[victim] = 1 << (FIN_C / 2);
+			for (int attacker = 0; attacker < 7; attacker++) {
+				if (can_capture(FIN(attacker * 2), FIN(victim * 2 + 1))) {
+					capturers[victim] |= 1 << attacker;
+				}
+			}
+		}
+	}
+};
+
+const CaptureTable captures;
+
+}  // namespace
+
+double pieceValue(FIN f) {
+	if (f == FIN_COVER || f == FIN_EMPTY) return 0;
+	return PIECE_VALUE[f / 2];
+}
+
+bool isAttacked(const FIN board[BOARD_SIZE], int sq, FIN victim, int color) {
+	const int* neighbors = neighborsOf(sq);
+	for (int dir = 0; dir < 4; dir++) {
+		int n = neighbors[dir];
+		if (n == -1) continue;
+		FIN attacker = board[n];
+		if (color_of(attacker) == color && type_of(attacker) != FIN_C &&
+		    can_capture(attacker, victim)) {
+			return true;
+		}
+	}
+
+	// 炮/包的翻山路線是對稱的：從 sq 翻山看得到的炮/包就吃得到 sq
+	int targets[4];
+	int count = cannonTargets(board, sq, targets);
+	for (int i = 0; i < count; i++) {
+		FIN attacker = board[targets[i]];
+		if (color_of(attacker) == color && type_of(attacker) == FIN_C) return true;
+	}
+	return false;
+}
+
+void TacticalHeuristic::operator()(const DarkChess_State& state,
+                                   const std::vector<DarkChess_Action>& actions,
+                                   std::vector<double>& scores) const {
+	FIN board[BOARD_SIZE];
+	for (int sq = 0; sq < BOARD_SIZE; sq++) board[sq] = state.getPiece(sq);
+
+	scores.assign(actions.size(), 0);
+	for (size_t i = 0; i < actions.size(); i++) {
+		int from = ActionMap[actions[i].getActionID()].first;
+		int to = ActionMap[actions[i].getActionID()].second;
+		if (from == to) continue; // 翻棋
+		// action 的 player 為上一手的玩家，即這一手的對手
+		int opp = actions[i].getPlayer();
+
+		FIN piece = board[from], victim = board[to];
+		double score = 0;
+		if (victim != FIN_EMPTY) {
+			score += pieceValue(victim);
+		} else if (isAttacked(board, from, piece, opp)) {
+			score += pieceValue(piece);
+		}
+
+		// 走完後的落點是否會被吃
+		board[from] = FIN_EMPTY;
+		board[to] = piece;
+		if (isAttacked(board, to, piece, opp)) score -= pieceValue(piece);
+		board[from] = piece;
+		board[to] = victim;
+
+		scores[i] = score;
+	}
+}
+
+ThreatMap::ThreatMap(const DarkChess_State& state) {
+	memset(count, 0, sizeof(count));
+	memset(mask, 0, sizeof(mask));
+	for (int sq = 0; sq < BOARD_SIZE; sq++) board[sq] = state.getPiece(sq);
+	for (int sq = 0; sq < BOARD_SIZE; sq++) update(sq, 1);
+}
+
+bool ThreatMap::attacked(int sq, FIN victim, int color) const {
+	return (mask[color][sq] & captures.capturers[victim / 2]) != 0;
+}
+
+void ThreatMap::apply(int from, int to, FIN revealed) {
+	if (from == to) {
+		board[from] = revealed;
+		update(from, 1);
+		return;
+	}
+
+	// 起點與終點同一行列上的炮/包翻山路線可能改變
+	int affected[2 + BOARD_SIZE];
+	int n = 0;
+	affected[n++] = from;
+	affected[n++] = to;
+	for (int origin : {from, to}) {
+		for (int dir = 0; dir < 4; dir++) {
+			for (int sq = neighborsOf(origin)[dir]; sq != -1; sq = neighborsOf(sq)[dir]) {
+				if (type_of(board[sq]) == FIN_C &&
+				    std::find(affected, affected + n, sq) == affected + n) {
+					affected[n++] = sq;
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < n; i++) update(affected[i], -1);
+	board[to] = board[from];
+	board[from] = FIN_EMPTY;
+	for (int i = 0; i < n; i++) update(affected[i], 1);
+}
+
+void ThreatMap::update(int sq, int delta) {
+	FIN piece = board[sq];
+	int color = color_of(piece);
+	if (color != RED && color != BLK) return;
+	int type = piece / 2;
+
+	auto add = [&](int target) {
+		uint8_t& c = count[color][target][type];
+		c += delta;
+		if (c == 0) {
+			mask[color][target] &= ~(1 << type);
+		} else {
+			mask[color][target] |= 1 << type;
+		}
+	};
+
+	if (type_of(piece) != FIN_C) {
+		const int* neighbors = neighborsOf(sq);
+		for (int dir = 0; dir < 4; dir++) {
+			if (neighbors[dir] != -1) add(neighbors[dir]);
+		}
+		return;
+	}
+
+	for (int dir = 0; dir < 4; dir++) {
+		bool screen = false;
+		for (int target = neighborsOf(sq)[dir]; target != -1;
+		     target = neighborsOf(target)[dir]) {
+			if (screen) {
+				add(target);
+				if (board[target] != FIN_EMPTY) break;
+			} else if (board[target] != FIN_EMPTY) {
+				screen = true;
+			}
+		}
+	}
+}
+
+HeavyPlayout::WeightTable::WeightTable() {
+	for (int own = 0; own < 5; own++) flip[own] = std::exp(TEMPERATURE * own * FLIP_BONUS);
+	for (int type = 0; type < 7; type++) {
+		gain[type] = std::exp(TEMPERATURE * PIECE_VALUE[type]);
+		loss[type] = std::exp(-TEMPERATURE * PIECE_VALUE[type]);
+	}
+}
+
+double HeavyPlayout::weight(const ThreatMap& threats, const DarkChess_Action& action,
+                            int side) const {
+	static const WeightTable table;
+
+	int from = ActionMap[action.getActionID()].first;
+	int to = ActionMap[action.getActionID()].second;
+
+	if (from == to) {
+		if (side != RED && side != BLK) return 1;
+		int own = 0;
+		const int* neighbors = neighborsOf(from);
+		for (int dir = 0; dir < 4; dir++) {
+			if (neighbors[dir] != -1 && color_of(threats.piece(neighbors[dir])) == side) own++;
+		}
+		return table.flip[own];
+	}
+
+	FIN piece = threats.piece(from), victim = threats.piece(to);
+	int opp = (color_of(piece) == RED) ? BLK : RED;
+	double weight = 1;
+	if (victim != FIN_EMPTY) {
+		weight = table.gain[victim / 2];
+	} else if (threats.attacked(from, piece, opp)) {
+		weight = table.gain[piece / 2];
+	}
+	if (threats.attacked(to, piece, opp)) weight *= table.loss[piece / 2];
+	return weight;
+}
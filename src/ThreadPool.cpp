@@ -0,0 +1,137 @@
+#include "ThreadPool.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threads, bool pin) {
+	threads = std::max(1, threads);
+	for (int i = 0; i < threads; i++) queues.emplace_back(new Queue());
+	for (int i = 0; i < threads; i++) {
+		workers.emplace_back(&ThreadPool::workerLoop, this, i, pin);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		shutting_down = true;
+	}
+	sleep_cv.notify_all();
+	for (auto& worker : workers) worker.join();
+}
+
+void ThreadPool::push(int queue, Task task) {
+	{
+		std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+		queues[queue]->tasks.push_back(std::move(task));
+	}
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		queued++;
+	}
+	sleep_cv.notify_one();
+}
+
+// 先取自己佇列的尾端，再依序偷取其他佇列的前端
+bool ThreadPool::pop(int worker, Task& task) {
+	int n = size();
+	for (int k = 0; k < n; k++) {
+		Queue& queue = *queues[(worker + k) % n];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty()) continue;
+		if (k == 0) {
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		} else {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::workerLoop(int worker, bool pin) {
+#ifdef __linux__
+	// 只在行程允許的核心中輪流綁定，可用 taskset 劃分多個行程
+	cpu_set_t allowed;
+	if (pin && sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+		int count = CPU_COUNT(&allowed);
+		int target = worker % count;
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (!CPU_ISSET(cpu, &allowed) || target-- > 0) continue;
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpu, &set);
+			pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+			break;
+		}
+	}
+#else
+	(void)pin;
+#endif
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(sleep_mutex);
+			sleep_cv.wait(lock, [this]() { return queued > 0 || shutting_down; });
+			if (queued == 0) return; // shutting_down 且沒有剩餘的工作
+			queued--;
+			running++;
+		}
+
+		// queued 保證至少有一個工作可取
+		Task task;
+		while (!pop(worker, task)) std::this_thread::yield();
+		task(worker);
+
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		running--;
+		if (queued == 0 && running == 0) idle_cv.notify_all();
+	}
+}
+
+void ThreadPool::submit(Task task) {
+	push(next_queue++ % size(), std::move(task));
+}
+
+void ThreadPool::wait() {
+	std::unique_lock<std::mutex> lock(sleep_mutex);
+	idle_cv.wait(lock, [this]() { return queued == 0 && running == 0; });
+}
+
+void ThreadPool::parallelFor(int count, int grain,
+                             const std::function<bool(int worker, int index)>& fn) {
+	if (count <= 0) return;
+	grain = std::max(1, grain);
+
+	struct Job {
+		std::atomic<bool> stop{false};
+		std::atomic<int> remaining{0};
+		std::mutex mutex;
+		std::condition_variable done;
+	} job;
+
+	// 依 worker 平均切成連續的區段，放進各自的佇列
+	int chunks = (count + grain - 1) / grain;
+	job.remaining = chunks;
+	int n = size();
+	for (int c = 0; c < chunks; c++) {
+		int begin = c * grain, end = std::min(count, begin + grain);
+		push((int)((long)c * n / chunks), [&job, &fn, begin, end](int worker) {
+			for (int i = begin; i < end && !job.stop.load(std::memory_order_relaxed); i++) {
+				if (!fn(worker, i)) job.stop = true;
+			}
+			// 在鎖內遞減：呼叫端要取得鎖才能看到 remaining == 0 並結束 job 的生命週期
+			std::lock_guard<std::mutex> lock(job.mutex);
+			if (--job.remaining == 0) job.done.notify_all();
+		});
+	}
+
+	std::unique_lock<std::mutex> lock(job.mutex);
+	job.done.wait(lock, [&job]() { return job.remaining == 0; });
+}
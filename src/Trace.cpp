@@ -0,0 +1,176 @@
+#include "Trace.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+const size_t RING_SIZE = 1 << 16; // 每個線程保留的事件數
+const int BUCKETS = 64;           // log2(ticks) 直方圖
+
+const char* PHASE_NAMES[TRACE_PHASE_COUNT] = {
+    "genmove", "select", "expand", "simulate", "backpropagate", "lock_wait",
+};
+
+struct Event {
+	uint64_t begin;
+	uint64_t end;
+	int phase;
+};
+
+struct Buffer {
+	int tid;
+	std::vector<Event> ring;
+	size_t written = 0; // 寫入過的事件總數
+	uint64_t count[TRACE_PHASE_COUNT];
+	uint64_t total[TRACE_PHASE_COUNT];
+	uint64_t max[TRACE_PHASE_COUNT];
+	uint64_t hist[TRACE_PHASE_COUNT][BUCKETS];
+
+	explicit Buffer(int tid) : tid(tid), ring(RING_SIZE) { clear(); }
+
+	void clear() {
+		written = 0;
+		memset(count, 0, sizeof(count));
+		memset(total, 0, sizeof(total));
+		memset(max, 0, sizeof(max));
+		memset(hist, 0, sizeof(hist));
+	}
+};
+
+std::atomic<bool> enabled(false);
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<Buffer>> buffers; // 線程結束後仍保留
+uint64_t start_tick = 0;
+std::chrono::steady_clock::time_point start_time;
+
+thread_local Buffer* local_buffer = nullptr;
+
+Buffer* localBuffer() {
+	if (local_buffer == nullptr) {
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		buffers.emplace_back(new Buffer((int)buffers.size() + 1));
+		local_buffer = buffers.back().get();
+	}
+	return local_buffer;
+}
+
+int bucketOf(uint64_t ticks) {
+	return ticks == 0 ? 0 : std::min(BUCKETS - 1, 64 - __builtin_clzll(ticks));
+}
+
+// 以 start() 至今的 steady_clock 校正 tick 的頻率
+double ticksPerMicrosecond() {
+	double us = std::chrono::duration<double, std::micro>(
+	                std::chrono::steady_clock::now() - start_time)
+	                .count();
+	double ticks = (double)(Trace::now() - start_tick);
+	return us > 0 && ticks > 0 ? ticks / us : 1.0;
+}
+
+}  // namespace
+
+void Trace::start() {
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	for (auto& buffer : buffers) buffer->clear();
+	start_time = std::chrono::steady_clock::now();
+	start_tick = now();
+	enabled = true;
+}
+
+void Trace::stop() { enabled = false; }
+
+bool Trace::isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+void Trace::record(int phase, uint64_t begin, uint64_t end) {
+	if (!isEnabled()) return;
+	Buffer* buffer = localBuffer();
+	uint64_t ticks = end - begin;
+	buffer->ring[buffer->written++ % RING_SIZE] = {begin, end, phase};
+	buffer->count[phase]++;
+	buffer->total[phase] += ticks;
+	buffer->max[phase] = std::max(buffer->max[phase], ticks);
+	buffer->hist[phase][bucketOf(ticks)]++;
+}
+
+bool Trace::writeChrome(const char* path) {
+	FILE* fp = fopen(path, "w");
+	if (fp == NULL) return false;
+
+	double tpu = ticksPerMicrosecond();
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	fprintf(fp, "{\"traceEvents\": [\n");
+	bool first = true;
+	for (const auto& buffer : buffers) {
+		size_t n = std::min(buffer->written, RING_SIZE);
+		size_t begin = buffer->written - n;
+		for (size_t i = begin; i < buffer->written; i++) {
+			const Event& e = buffer->ring[i % RING_SIZE];
+			if (e.begin < start_tick) continue;
+			fprintf(fp,
+			        "%s  {\"name\": \"%s\", \"cat\": \"mcts\", \"ph\": \"X\", "
+			        "\"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d}",
+			        first ? "" : ",\n", PHASE_NAMES[e.phase],
+			        (e.begin - start_tick) / tpu, (e.end - e.begin) / tpu, buffer->tid);
+			first = false;
+		}
+	}
+	fprintf(fp, "\n], \"displayTimeUnit\": \"ns\"}\n");
+	return fclose(fp) == 0;
+}
+
+void Trace::writeHistogram(FILE* fp) {
+	double tpu = ticksPerMicrosecond();
+	std::lock_guard<std::mutex> lock(registry_mutex);
+
+	fprintf(fp, "%-14s %10s %11s %9s %9s %9s %9s %9s\n", "phase", "count", "total ms",
+	        "mean us", "p50 us", "p90 us", "p99 us", "max us");
+	for (int phase = 0; phase < TRACE_PHASE_COUNT; phase++) {
+		uint64_t count = 0, total = 0, max = 0, hist[BUCKETS] = {0};
+		for (const auto& buffer : buffers) {
+			count += buffer->count[phase];
+			total += buffer->total[phase];
+			max = std::max(max, buffer->max[phase]);
+			for (int b = 0; b < BUCKETS; b++) hist[b] += buffer->hist[phase][b];
+		}
+		if (count == 0) continue;
+
+		// 百分位數取所在 bucket 的上界
+		double pct[3] = {0.5, 0.9, 0.99}, value[3];
+		for (int k = 0; k < 3; k++) {
+			uint64_t target = (uint64_t)(pct[k] * count), seen = 0;
+			int b = 0;
+			while (b < BUCKETS - 1 && (seen += hist[b]) <= target) b++;
+			value[k] = std::min((double)max, (double)(1ULL << b)) / tpu;
+		}
+		fprintf(fp, "%-14s %10llu %11.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n",
+		        PHASE_NAMES[phase], (unsigned long long)count, total / tpu / 1000,
+		        total / tpu / count, value[0], value[1], value[2], max / tpu);
+	}
+
+	// 各階段的 log2 直方圖，每列為 [下界, 上界) us 與次數
+	for (int phase = 0; phase < TRACE_PHASE_COUNT; phase++) {
+		uint64_t hist[BUCKETS] = {0};
+		uint64_t count = 0;
+		for (const auto& buffer : buffers) {
+			for (int b = 0; b < BUCKETS; b++) {
+				hist[b] += buffer->hist[phase][b];
+				count += buffer->hist[phase][b];
+			}
+		}
+		if (count == 0) continue;
+		fprintf(fp, "%s:\n", PHASE_NAMES[phase]);
+		for (int b = 0; b < BUCKETS; b++) {
+			if (hist[b] == 0) continue;
+			double lo = b == 0 ? 0 : (double)(1ULL << (b - 1)) / tpu;
+			double hi = (double)(1ULL << b) / tpu;
+			fprintf(fp, "  [%10.3f, %10.3f) %10llu %5.1f%%\n", lo, hi,
+			        (unsigned long long)hist[b], 100.0 * hist[b] / count);
+		}
+	}
+}
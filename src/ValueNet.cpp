@@ -0,0 +1,304 @@
+#include "ValueNet.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const char VNET_MAGIC[8] = {'C', 'D', 'C', 'V', 'N', 'E', 'T', '1'};
+
+// 一個盤面最多的特徵數：32 格 + 14 種暗子 + 輪到的一方 + 無吃翻
+static const int MAX_FEATURES = BOARD_SIZE + 14 + 2;
+
+namespace {
+
+// acc += value * row（飽和加法）
+inline void addRow(int16_t* acc, const int16_t* row, int value) {
+#if defined(__AVX2__)
+	const __m256i v = _mm256_set1_epi16(value);
+	for (int i = 0; i < ValueNet::HIDDEN1; i += 16) {
+		__m256i r = _mm256_load_si256((const __m256i*)(row + i));
+		if (value != 1) r = _mm256_mullo_epi16(r, v);
+		__m256i a = _mm256_load_si256((const __m256i*)(acc + i));
+		_mm256_store_si256((__m256i*)(acc + i), _mm256_adds_epi16(a, r));
+	}
+#elif defined(__SSE2__)
+	const __m128i v = _mm_set1_epi16(value);
+	for (int i = 0; i < ValueNet::HIDDEN1; i += 8) {
+		__m128i r = _mm_load_si128((const __m128i*)(row + i));
+		if (value != 1) r = _mm_mullo_epi16(r, v);
+		__m128i a = _mm_load_si128((const __m128i*)(acc + i));
+		_mm_store_si128((__m128i*)(acc + i), _mm_adds_epi16(a, r));
+	}
+#else
+	for (int i = 0; i < ValueNet::HIDDEN1; i++) {
+		int sum = acc[i] + (int16_t)(row[i] * value);
+		acc[i] = (int16_t)std::min(32767, std::max(-32768, sum));
+	}
+#endif
+}
+
+// int16 累加值限制到 [0, QA] 並轉為 uint8
+inline void clipHidden(const int16_t* acc, uint8_t* out) {
+#if defined(__AVX2__)
+	const __m256i limit = _mm256_set1_epi8(ValueNet::QA);
+	for (int i = 0; i < ValueNet::HIDDEN1; i += 32) {
+		__m256i a = _mm256_load_si256((const __m256i*)(acc + i));
+		__m256i b = _mm256_load_si256((const __m256i*)(acc + i + 16));
+		// packus 以 128 位元為單位交錯，需重排
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+		_mm256_store_si256((__m256i*)(out + i), _mm256_min_epu8(packed, limit));
+	}
+#elif defined(__SSE2__)
+	const __m128i limit = _mm_set1_epi8(ValueNet::QA);
+	for (int i = 0; i < ValueNet::HIDDEN1; i += 16) {
+		__m128i a = _mm_load_si128((const __m128i*)(acc + i));
+		__m128i b = _mm_load_si128((const __m128i*)(acc + i + 8));
+		_mm_store_si128((__m128i*)(out + i),
+		                _mm_min_epu8(_mm_packus_epi16(a, b), limit));
+	}
+#else
+	for (int i = 0; i < ValueNet::HIDDEN1; i++) {
+		out[i] = (uint8_t)std::min<int>(ValueNet::QA, std::max<int>(0, acc[i]));
+	}
+#endif
+}
+
+// HIDDEN1 個 uint8 與 int8 的內積
+inline int32_t dot(const uint8_t* a, const int8_t* w) {
+#if defined(__AVX2__)
+	const __m256i ones = _mm256_set1_epi16(1);
+	__m256i sum = _mm256_setzero_si256();
+	for (int i = 0; i < ValueNet::HIDDEN1; i += 32) {
+		__m256i x = _mm256_load_si256((const __m256i*)(a + i));
+		__m256i y = _mm256_load_si256((const __m256i*)(w + i));
+		// a <= 127，兩兩相加不會飽和
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(x, y), ones));
+	}
+	__m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+	return _mm_cvtsi128_si32(s);
+#elif defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum = _mm_setzero_si128();
+	for (int i = 0; i < ValueNet::HIDDEN1; i += 16) {
+		__m128i x = _mm_load_si128((const __m128i*)(a + i));
+		__m128i y = _mm_load_si128((const __m128i*)(w + i));
+		// uint8 補零、int8 符號延伸為 int16
+		__m128i x_lo = _mm_unpacklo_epi8(x, zero);
+		__m128i x_hi = _mm_unpackhi_epi8(x, zero);
+		__m128i y_lo = _mm_srai_epi16(_mm_unpacklo_epi8(y, y), 8);
+		__m128i y_hi = _mm_srai_epi16(_mm_unpackhi_epi8(y, y), 8);
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(x_lo, y_lo));
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(x_hi, y_hi));
+	}
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+	return _mm_cvtsi128_si32(sum);
+#else
+	int32_t sum = 0;
+	for (int i = 0; i < ValueNet::HIDDEN1; i++) sum += a[i] * w[i];
+	return sum;
+#endif
+}
+
+inline int16_t quantize16(float x) {
+	return (int16_t)std::min(32767.0f, std::max(-32768.0f, roundf(x)));
+}
+
+inline int8_t quantize8(float x) {
+	return (int8_t)std::min(127.0f, std::max(-127.0f, roundf(x)));
+}
+
+}  // namespace
+
+bool ValueNet::load(const char* path) {
+	loaded = false;
+	FILE* fp = fopen(path, "rb");
+	if (fp == NULL) return false;
+
+	ValueNetHeader header;
+	bool ok = fread(&header, sizeof(header), 1, fp) == 1 &&
+	          memcmp(header.magic, VNET_MAGIC, sizeof(VNET_MAGIC)) == 0 &&
+	          header.version == VERSION && header.inputs == INPUTS &&
+	          header.hidden1 == HIDDEN1 && header.hidden2 == HIDDEN2;
+	ok = ok && fread(w1, sizeof(w1), 1, fp) == 1 && fread(b1, sizeof(b1), 1, fp) == 1 &&
+	     fread(w2, sizeof(w2), 1, fp) == 1 && fread(b2, sizeof(b2), 1, fp) == 1 &&
+	     fread(w3, sizeof(w3), 1, fp) == 1 && fread(&b3, sizeof(b3), 1, fp) == 1 &&
+	     fgetc(fp) == EOF;
+	fclose(fp);
+	loaded = ok;
+	return ok;
+}
+
+bool ValueNet::save(const char* path) const {
+	FILE* fp = fopen(path, "wb");
+	if (fp == NULL) return false;
+
+	ValueNetHeader header;
+	memcpy(header.magic, VNET_MAGIC, sizeof(VNET_MAGIC));
+	header.version = VERSION;
+	header.inputs = INPUTS;
+	header.hidden1 = HIDDEN1;
+	header.hidden2 = HIDDEN2;
+	bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+	          fwrite(w1, sizeof(w1), 1, fp) == 1 && fwrite(b1, sizeof(b1), 1, fp) == 1 &&
+	          fwrite(w2, sizeof(w2), 1, fp) == 1 && fwrite(b2, sizeof(b2), 1, fp) == 1 &&
+	          fwrite(w3, sizeof(w3), 1, fp) == 1 && fwrite(&b3, sizeof(b3), 1, fp) == 1;
+	return fclose(fp) == 0 && ok;
+}
+
+void ValueNet::initRandom(unsigned int seed) {
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<int> small(-64, 64);
+	for (int i = 0; i < INPUTS; i++) {
+		for (int j = 0; j < HIDDEN1; j++) w1[i][j] = small(rng);
+	}
+	for (int j = 0; j < HIDDEN1; j++) b1[j] = small(rng);
+	for (int i = 0; i < HIDDEN2; i++) {
+		for (int j = 0; j < HIDDEN1; j++) w2[i][j] = small(rng);
+		b2[i] = small(rng) * QA;
+	}
+	for (int i = 0; i < HIDDEN2; i++) w3[i] = small(rng);
+	b3 = 0;
+	loaded = true;
+}
+
+void ValueNet::quantize(const float* fw1, const float* fb1, const float* fw2,
+                        const float* fb2, const float* fw3, float fb3) {
+	for (int i = 0; i < INPUTS; i++) {
+		for (int j = 0; j < HIDDEN1; j++) w1[i][j] = quantize16(fw1[i * HIDDEN1 + j] * QA);
+	}
+	for (int j = 0; j < HIDDEN1; j++) b1[j] = quantize16(fb1[j] * QA);
+	for (int i = 0; i < HIDDEN2; i++) {
+		for (int j = 0; j < HIDDEN1; j++) w2[i][j] = quantize8(fw2[i * HIDDEN1 + j] * QB);
+		b2[i] = (int32_t)roundf(fb2[i] * QA * QB);
+	}
+	for (int i = 0; i < HIDDEN2; i++) w3[i] = quantize8(fw3[i] * QB);
+	b3 = (int32_t)roundf(fb3 * QA * QB);
+	loaded = true;
+}
+
+int ValueNet::features(const DarkChess_State& state, Feature* out) {
+	int n = 0;
+	for (int sq = 0; sq < BOARD_SIZE; sq++) {
+		FIN f = state.getPiece(sq);
+		if (f != FIN_EMPTY) out[n++] = {sq * 15 + f, 1};
+	}
+	for (int f = 0; f < 14; f++) {
+		int count = state.getCoverCount(f);
+		if (count > 0) out[n++] = {COVER_FEATURE + f, count};
+	}
+	int side = state.getSideToMove();
+	if (side != UNKNOWN) out[n++] = {SIDE_FEATURE + side, 1};
+	// 以 16 步為單位，避免累加溢位
+	int no_eat_flip = state.getNoEatFlip() / 16;
+	if (no_eat_flip > 0) out[n++] = {NO_EAT_FLIP_FEATURE, no_eat_flip};
+	return n;
+}
+
+// 第一層：只累加有出現的特徵
+void ValueNet::hidden(const DarkChess_State& state, uint8_t* out) const {
+	Feature active[MAX_FEATURES];
+	int n = features(state, active);
+
+	alignas(32) int16_t acc[HIDDEN1];
+	memcpy(acc, b1, sizeof(acc));
+	for (int i = 0; i < n; i++) addRow(acc, w1[active[i].index], active[i].value);
+	clipHidden(acc, out);
+}
+
+float ValueNet::output(const uint8_t* h1) const {
+	int32_t sum = b3;
+	for (int i = 0; i < HIDDEN2; i++) {
+		// 第二層輸出為 QA * QB 倍，除以 QB 回到激活值的比例
+		int32_t h2 = std::min(QA, std::max(0, (dot(h1, w2[i]) + b2[i]) / QB));
+		sum += h2 * w3[i];
+	}
+	return tanhf((float)sum / (QA * QB));
+}
+
+float ValueNet::evaluate(const DarkChess_State& state) const {
+	alignas(32) uint8_t h1[HIDDEN1];
+	hidden(state, h1);
+	return output(h1);
+}
+
+void ValueNet::evaluate(const DarkChess_State* const* states, int count,
+                        float* values) const {
+	const int BLOCK = 16;
+	alignas(32) uint8_t h1[BLOCK][HIDDEN1];
+	int32_t sum[BLOCK];
+
+	for (int start = 0; start < count; start += BLOCK) {
+		int n = std::min(BLOCK, count - start);
+		for (int p = 0; p < n; p++) {
+			hidden(*states[start + p], h1[p]);
+			sum[p] = b3;
+		}
+		// 每一列第二層權重讀入後供整批使用
+		for (int i = 0; i < HIDDEN2; i++) {
+			for (int p = 0; p < n; p++) {
+				int32_t h2 = std::min(QA, std::max(0, (dot(h1[p], w2[i]) + b2[i]) / QB));
+				sum[p] += h2 * w3[i];
+			}
+		}
+		for (int p = 0; p < n; p++) {
+			values[start + p] = tanhf((float)sum[p] / (QA * QB));
+		}
+	}
+}
+
+float ValueBatcher::evaluate(const DarkChess_State& state) {
+	Request request = {&state, 0, false, false};
+	std::unique_lock<std::mutex> lock(mutex);
+	pending.push_back(&request);
+	if ((int)pending.size() >= batch_size) {
+		flush(lock);
+		return request.value;
+	}
+
+	auto deadline = std::chrono::steady_clock::now() +
+	                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+	                    std::chrono::duration<double, std::micro>(timeout_us));
+	while (!request.done) {
+		if (request.taken) {
+			cv.wait(lock); // 其他線程正在評估這一批
+		} else if (cv.wait_until(lock, deadline) == std::cv_status::timeout &&
+		           !request.taken) {
+			flush(lock);
+		}
+	}
+	return request.value;
+}
+
+// 取出目前所有等待中的請求，在鎖外評估
+void ValueBatcher::flush(std::unique_lock<std::mutex>& lock) {
+	std::vector<Request*> batch;
+	batch.swap(pending);
+	for (Request* request : batch) request->taken = true;
+	lock.unlock();
+
+	std::vector<const DarkChess_State*> states;
+	for (Request* request : batch) states.push_back(request->state);
+	std::vector<float> values(batch.size());
+	net.evaluate(states.data(), (int)states.size(), values.data());
+
+	lock.lock();
+	for (size_t i = 0; i < batch.size(); i++) {
+		batch[i]->value = values[i];
+		batch[i]->done = true;
+	}
+	batches++;
+	evaluations += batch.size();
+	cv.notify_all();
+}
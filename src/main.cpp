@@ -1,10 +1,16 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
 #include "MyAI.h"
+#include "Trace.h"
 #include "libchess.h"
 
-#define COMMAND_NUM 19
+#define COMMAND_NUM 20
 const char* commands_name[COMMAND_NUM] = {
     "protocol_version",  "name",          "version",
     "known_command",     "list_commands", "quit",
@@ -12,123 +18,300 @@ const char* commands_name[COMMAND_NUM] = {
     "num_moves_to_draw", "move",          "flip",
     "genmove",           "game_over",     "ready",
     "time_settings",     "time_left",     "showboard",
-    "init_board"};
+    "init_board",        "bench"};
+
+/*
+ * Command line options
+ *   --seed <n>      deterministic search with master seed n
+ *   --playouts <n>  number of playouts per genmove
+ *   --threads <n>   number of search threads
+ *   --pin <0|1>     pin the search threads to fixed CPUs (default 0)
+ *   --procs <n>     number of search processes, each with --threads threads
+ *   --playout <p>   playout policy without a value network: random or heavy
+ *   --book <file>   opening book built by tools/book_builder
+ *   --tb <dir>      endgame tablebases built by tools/tb_generator
+ *   --vnet <file>   value network built by tools/vnet_trainer
+ *   --time <ms>     time budget per genmove
+ *   --replay <file> replay a recorded MGTP session instead of reading stdin
+ *   --trace <file>  write a Chrome trace of the search on exit and print
+ *                   per-phase histograms to stderr (needs make TRACE=1)
+ *   --bench [n]     search the built-in bench positions with n playouts each
+ *                   (default BENCH_PLAYOUTS), print the summary and exit
+ *
+ * @return false if an option is missing its value
+ */
+static bool ParseArgs(MyAI& myai, int argc, char* argv[], const char*& replay,
+                      const char*& trace, int& bench) {
+	for (int i = 1; i < argc; i++) {
+		const char* option = argv[i];
+		// --bench 的 playout 數可省略
+		if (strcmp(option, "--bench") == 0) {
+			bench = 0;
+			if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) bench = atoi(argv[++i]);
+			continue;
+		}
+		if (i + 1 >= argc) {
+			fprintf(stderr, "option %s needs a value\n", option);
+			return false;
+		}
+
+		const char* value = argv[++i];
+		if (strcmp(option, "--seed") == 0) {
+			myai.SetDeterministic(strtoul(value, NULL, 10));
+		} else if (strcmp(option, "--playouts") == 0) {
+			myai.SetSimulationCount(atoi(value));
+		} else if (strcmp(option, "--pin") == 0) {
+			myai.SetPinThreads(atoi(value) != 0);
+		} else if (strcmp(option, "--procs") == 0) {
+			myai.SetProcessCount(atoi(value));
+		} else if (strcmp(option, "--threads") == 0) {
+			myai.SetThreadCount(atoi(value));
+		} else if (strcmp(option, "--playout") == 0) {
+			if (!myai.SetPlayout(value)) {
+				fprintf(stderr, "unknown playout policy %s\n", value);
+			}
+		} else if (strcmp(option, "--book") == 0) {
+			if (!myai.LoadBook(value)) {
+				fprintf(stderr, "cannot load opening book %s\n", value);
+			}
+		} else if (strcmp(option, "--tb") == 0) {
+			if (myai.LoadTablebase(value) == 0) {
+				fprintf(stderr, "cannot load tablebases from %s\n", value);
+			}
+		} else if (strcmp(option, "--vnet") == 0) {
+			if (!myai.LoadValueNet(value)) {
+				fprintf(stderr, "cannot load value network %s\n", value);
+			}
+		} else if (strcmp(option, "--time") == 0) {
+			myai.SetTimeBudget(atoi(value));
+		} else if (strcmp(option, "--replay") == 0) {
+			replay = value;
+		} else if (strcmp(option, "--trace") == 0) {
+			trace = value;
+		} else {
+			fprintf(stderr, "unknown option %s\n", option);
+		}
+	}
+	return true;
+}
 
-int main() {
+/*
+ * Handle one MGTP command and send the result to the MGTP server
+ *
+ * @param read : the command line, modified in place
+ * @return the command id
+ */
+static int HandleCommand(MyAI& myai, char* read) {
 	std::string write;
-	char read[1024], *token;
+	char* token;
 	const char* data[100];
-	int id, i;
-	MyAI myai;
+	int id = -1, i;
 
-	// Game Loop
-	do {
-		write.clear();
-		// read command
-		fgets(read, 1024, stdin);
-
-		printf("get= %s\n", read);
-		// remove newline(\n)
-		read[strlen(read) - 1] = '\0';
-		// get command id
-		token = strtok(read, " ");
-		sscanf(token, "%d", &id);
-		// get command name
-		token = strtok(NULL, " ");
-		// get command data
-		i = 0;
-		while ((token = strtok(NULL, " ")) != NULL) {
-			data[i++] = token;
-		}
+	printf("get= %s\n", read);
+	// remove newline(\n)
+	read[strcspn(read, "\r\n")] = '\0';
+	// get command id
+	token = strtok(read, " ");
+	if (token == NULL) return id;
+	sscanf(token, "%d", &id);
+	// get command name
+	token = strtok(NULL, " ");
+	// get command data
+	i = 0;
+	while ((token = strtok(NULL, " ")) != NULL) {
+		data[i++] = token;
+	}
 
-		switch (id) {
-			case 0: // protocol_version
-				write = myai.GetProtocolVersion();
-				break;
-			case 1: // name
-				write = myai.GetAIName();
-				break;
-			case 2: // version
-				write = myai.GetAIVersion();
-				break;
-			case 3: // known_command
-				for (i = 0; i < COMMAND_NUM; i++) {
-					if (strcmp(data[0], commands_name[i]) == 0) {
-						break;
-					}
-				}
-				write = i == COMMAND_NUM ? "false" : "true";
-				break;
-			case 4: // list_commands
-				for (int i = 0; i < COMMAND_NUM; i++) {
-					write += commands_name[i];
-					write += "\n";
-				}
-				break;
-			case 5: // quit
-				break;
-			case 6: // boardsize
-				break;
-			case 7: // reset_board
-				myai.InitBoard();
-				myai.Print();
-				break;
-			case 8: // num_repetition
-				break;
-			case 9: // num_moves_to_draw
-				break;
-			case 10: // move
-				myai.Move(string2square(data[0]), string2square(data[1]));
-				myai.Print();
-				break;
-			case 11: // flip
-				myai.Flip(string2square(data[0]), char2fin(data[1][0]));
-				myai.Print();
-				break;
-			case 12: // genmove
-				int curr_color;
-				if (strcmp(data[0], "red") == 0) {
-					myai.SetColor(RED);
-					curr_color = RED;
-				} else if (strcmp(data[0], "black") == 0) {
-					myai.SetColor(BLK);
-					curr_color = BLK;
-				} else {
-					myai.SetColor(UNKNOWN);
-					curr_color = UNKNOWN;
+	switch (id) {
+		case 0: // protocol_version
+			write = myai.GetProtocolVersion();
+			break;
+		case 1: // name
+			write = myai.GetAIName();
+			break;
+		case 2: // version
+			write = myai.GetAIVersion();
+			break;
+		case 3: // known_command
+			for (i = 0; i < COMMAND_NUM; i++) {
+				if (strcmp(data[0], commands_name[i]) == 0) {
+					break;
 				}
-
-				write = to_string(myai.GenerateMove(curr_color));
-				break;
-			case 13: // game_over
-				printf("game_over %s\n", data[0]);
-				break;
-			case 14: // ready
-				break;
-			case 15: // time_settings
-				break;
-			case 16: // time_left
-			{
-				COLOR color = strcmp(data[0], "red") == 1 ? RED : BLK;
-				int time;
-				sscanf(data[1], "%d", &time);
-				myai.SetTime(color, time);
-				break;
 			}
-			case 17: // showboard
-				myai.Print();
-				break;
-			case 18: // init_board
-				break;
+			write = i == COMMAND_NUM ? "false" : "true";
+			break;
+		case 4: // list_commands
+			for (int i = 0; i < COMMAND_NUM; i++) {
+				write += commands_name[i];
+				write += "\n";
+			}
+			break;
+		case 5: // quit
+			break;
+		case 6: // boardsize
+			break;
+		case 7: // reset_board
+			myai.InitBoard();
+			myai.Print();
+			break;
+		case 8: // num_repetition
+			break;
+		case 9: // num_moves_to_draw
+			break;
+		case 10: // move
+			myai.Move(string2square(data[0]), string2square(data[1]));
+			myai.Print();
+			break;
+		case 11: // flip
+			myai.Flip(string2square(data[0]), char2fin(data[1][0]));
+			myai.Print();
+			break;
+		case 12: // genmove
+			int curr_color;
+			if (strcmp(data[0], "red") == 0) {
+				myai.SetColor(RED);
+				curr_color = RED;
+			} else if (strcmp(data[0], "black") == 0) {
+				myai.SetColor(BLK);
+				curr_color = BLK;
+			} else {
+				myai.SetColor(UNKNOWN);
+				curr_color = UNKNOWN;
+			}
+
+			write = to_string(myai.GenerateMove(curr_color));
+			break;
+		case 13: // game_over
+			printf("game_over %s\n", data[0]);
+			break;
+		case 14: // ready
+			break;
+		case 15: // time_settings
+			break;
+		case 16: // time_left
+		{
+			COLOR color = strcmp(data[0], "red") == 1 ? RED : BLK;
+			int time;
+			sscanf(data[1], "%d", &time);
+			myai.SetTime(color, time);
+			break;
 		}
+		case 17: // showboard
+			myai.Print();
+			break;
+		case 18: // init_board
+			break;
+		case 19: // bench [playouts]
+			write = myai.Bench(i > 0 ? atoi(data[0]) : 0);
+			break;
+	}
+
+	/// Send result to MGTP server
+	printf("=%d %s\n", id, write.c_str());
+
+	fflush(stdout);
+	fflush(stderr);
+	return id;
+}
+
+/*
+ * Replay a recorded MGTP session through the same dispatch as stdin and
+ * report the latency and search counters of every genmove on stderr
+ *
+ * @param path : the session file, one MGTP command per line; lines that
+ *               do not start with a command id (e.g. responses) are skipped
+ */
+static int Replay(MyAI& myai, const char* path) {
+	FILE* fp = fopen(path, "r");
+	if (fp == NULL) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return 1;
+	}
 
-		/// Send result to MGTP server
-		printf("=%d %s\n", id, write.c_str());
+	char read[1024];
+	std::vector<double> latency;
+	long total_playouts = 0;
+	while (fgets(read, sizeof(read), fp) != NULL) {
+		if (read[0] < '0' || read[0] > '9') continue;
 
-		fflush(stdout);
-		fflush(stderr);
+		int id = -1;
+		sscanf(read, "%d", &id);
+		auto start = std::chrono::steady_clock::now();
+		HandleCommand(myai, read);
+		double elapsed = std::chrono::duration<double, std::milli>(
+		                     std::chrono::steady_clock::now() - start)
+		                     .count();
 
-	} while (id != 5); // Quit if receive a quit command
+		if (id == 12) { // genmove
+			const SearchStats& stats = myai.GetSearchStats();
+			latency.push_back(elapsed);
+			total_playouts += stats.playouts;
+			fprintf(stderr,
+			        "genmove %zu: %.1f ms, %d playouts, %d nodes, depth %d, search %.1f ms%s\n",
+			        latency.size(), elapsed, stats.playouts, stats.nodes, stats.depth,
+			        stats.elapsed_ms, stats.book_hit ? " (book)" : "");
+		} else if (id == 5) { // quit
+			break;
+		}
+	}
+	fclose(fp);
 
+	if (latency.empty()) {
+		fprintf(stderr, "no genmove in %s\n", path);
+		return 0;
+	}
+	double total = 0;
+	for (double t : latency) total += t;
+	std::sort(latency.begin(), latency.end());
+	auto percentile = [&latency](double p) {
+		return latency[std::min(latency.size() - 1,
+		                        (size_t)(p * (latency.size() - 1) + 0.5))];
+	};
+	fprintf(stderr,
+	        "replay %s: %zu genmove, total %.1f ms, p50 %.1f p90 %.1f p99 %.1f "
+	        "max %.1f ms, %ld playouts, %.0f playouts/s\n",
+	        path, latency.size(), total, percentile(0.5), percentile(0.9),
+	        percentile(0.99), latency.back(), total_playouts,
+	        total > 0 ? total_playouts * 1000.0 / total : 0.0);
 	return 0;
-}
\ No newline at end of file
+}
+
+int main(int argc, char* argv[]) {
+	char read[1024];
+	int id;
+	const char* replay = NULL;
+	const char* trace = NULL;
+	int bench = -1;
+	int ret = 0;
+	MyAI myai;
+
+	if (!ParseArgs(myai, argc, argv, replay, trace, bench)) return 1;
+	if (trace != NULL) {
+#ifndef CDC_TRACE
+		fprintf(stderr, "tracing is not compiled in, rebuild with make TRACE=1\n");
+#endif
+		Trace::start();
+	}
+
+	if (bench >= 0) {
+		printf("bench: %s\n", myai.Bench(bench).c_str());
+	} else if (replay != NULL) {
+		ret = Replay(myai, replay);
+	} else {
+		// Game Loop
+		do {
+			// read command
+			if (fgets(read, 1024, stdin) == NULL) break;
+			id = HandleCommand(myai, read);
+		} while (id != 5); // Quit if receive a quit command
+	}
+
+	if (trace != NULL) {
+		Trace::stop();
+		if (!Trace::writeChrome(trace)) {
+			fprintf(stderr, "cannot write trace %s\n", trace);
+		}
+		Trace::writeHistogram(stderr);
+	}
+	return ret;
+}
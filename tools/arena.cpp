@@ -0,0 +1,372 @@
+/*
+ * Local self-play arena
+ *
+ * Launches two engines as child processes, referees games between them over
+ * the MGTP protocol and enforces the rules of DarkChess_State. Games run in
+ * parallel and the engines alternate who moves first.
+ *
+ * An engine that stops answering mid-game forfeits the game; an engine that
+ * does not start at all aborts the run. By default the number of parallel
+ * games is the core count divided by the search threads of one engine, so
+ * the reported latencies are not inflated by oversubscription.
+ *
+ * usage: arena [-a "bin/cdc ..."] [-b "bin/cdc ..."] [-n games] [-j jobs]
+ *              [-t time_ms] [-s seed]
+ */
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DarkChess.h"
+#include "libchess.h"
+
+#define MAX_PLIES 1000
+#define ENGINE_DEFAULT_THREADS 4 // cdc 未指定 --threads 時的搜尋線程數
+
+struct Options {
+	std::string engine[2] = {"bin/cdc", "bin/cdc"};
+	int games = 100;
+	int jobs = 0;
+	int time_ms = 0; // 每局每方的總時間，0 表示不限時
+	unsigned int seed = 1;
+};
+
+// 以 pipe 連接的引擎子行程
+class Engine {
+	public:
+		~Engine() { stop(); }
+
+		bool start(const std::string& command) {
+			std::vector<std::string> args;
+			size_t pos = 0;
+			while (pos < command.size()) {
+				size_t end = command.find(' ', pos);
+				if (end == std::string::npos) end = command.size();
+				if (end > pos) args.push_back(command.substr(pos, end - pos));
+				pos = end + 1;
+			}
+			if (args.empty()) return false;
+
+			int to_child[2], from_child[2];
+			if (pipe2(to_child, O_CLOEXEC) != 0) return false;
+			if (pipe2(from_child, O_CLOEXEC) != 0) {
+				close(to_child[0]);
+				close(to_child[1]);
+				return false;
+			}
+
+			pid = fork();
+			if (pid == 0) {
+				dup2(to_child[0], STDIN_FILENO);
+				dup2(from_child[1], STDOUT_FILENO);
+				int null_fd = open("/dev/null", O_WRONLY);
+				if (null_fd >= 0) dup2(null_fd, STDERR_FILENO);
+
+				std::vector<char*> argv;
+				for (auto& arg : args) argv.push_back(&arg[0]);
+				argv.push_back(NULL);
+				execvp(argv[0], argv.data());
+				_exit(127);
+			}
+			close(to_child[0]);
+			close(from_child[1]);
+			if (pid < 0) {
+				close(to_child[1]);
+				close(from_child[0]);
+				return false;
+			}
+			in = fdopen(to_child[1], "w");
+			out = fdopen(from_child[0], "r");
+			return in != NULL && out != NULL;
+		}
+
+		// 送出指令並讀取 "=id ..." 回應，引擎結束或無回應時回傳 false
+		bool send(int id, const std::string& command, std::string& reply) {
+			if (fprintf(in, "%d %s\n", id, command.c_str()) < 0 || fflush(in) != 0) {
+				return false;
+			}
+			char line[1024];
+			char prefix[16];
+			int prefix_len = snprintf(prefix, sizeof(prefix), "=%d", id);
+			while (fgets(line, sizeof(line), out) != NULL) {
+				if (strncmp(line, prefix, prefix_len) == 0 &&
+				    (line[prefix_len] == ' ' || line[prefix_len] == '\n')) {
+					reply = line + prefix_len;
+					reply.erase(0, reply.find_first_not_of(' '));
+					reply.erase(reply.find_last_not_of("\r\n") + 1);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void stop() {
+			if (in != NULL) {
+				std::string reply;
+				send(5, "quit", reply);
+				fclose(in);
+			}
+			if (out != NULL) fclose(out);
+			if (pid > 0) waitpid(pid, NULL, 0);
+			in = out = NULL;
+			pid = -1;
+		}
+
+	private:
+		pid_t pid = -1;
+		FILE* in = NULL;
+		FILE* out = NULL;
+};
+
+struct GameResult {
+	int score;                    // 以引擎 A 為視角：2 勝、1 和、0 負
+	int forfeit = -1;             // 中途無回應而判負的引擎
+	bool failed = false;          // 有引擎無法啟動，整個對戰中止
+	std::vector<double> latency[2]; // 每次 genmove 的延遲 (ms)
+};
+
+static std::string SquareName(int sq) {
+	return std::string() + char('a' + sq / ROW_COUNT) + char('1' + sq % ROW_COUNT);
+}
+
+static const char* ColorName(int color) {
+	return color == RED ? "red" : color == BLK ? "black" : "unknown";
+}
+
+static GameResult PlayGame(const Options& opt, int game) {
+	GameResult result;
+	result.score = 1;
+
+	// 引擎 A 在偶數局先手
+	int first = game % 2;
+	Engine engine[2];
+	// 啟動後先以 protocol_version 確認引擎有回應
+	for (int e = 0; e < 2; e++) {
+		std::string reply;
+		if (!engine[e].start(opt.engine[e]) || !engine[e].send(0, "protocol_version", reply)) {
+			fprintf(stderr, "cannot start engine %c: %s\n", "AB"[e], opt.engine[e].c_str());
+			result.failed = true;
+			return result;
+		}
+	}
+
+	// 隱藏的棋子
+	std::seed_seq seq{opt.seed, static_cast<unsigned int>(game)};
+	std::mt19937 rng(seq);
+	const int pieces[14] = {1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 5, 5};
+	std::vector<FIN> hidden;
+	for (int i = 0; i < 14; i++) hidden.insert(hidden.end(), pieces[i], FIN(i));
+	std::shuffle(hidden.begin(), hidden.end(), rng);
+
+	DarkChess_State state;
+	int color[2] = {UNKNOWN, UNKNOWN}; // 兩個引擎的顏色
+	int time_left[2] = {opt.time_ms, opt.time_ms};
+	int turn = first;
+	int winner = -1; // 獲勝的引擎，-1 為和局
+
+	for (int ply = 0; ply < MAX_PLIES; ply++) {
+		std::string reply;
+		if (opt.time_ms > 0 &&
+		    !engine[turn].send(16, std::string("time_left ") + ColorName(color[turn]) +
+		                               " " + std::to_string(time_left[turn]),
+		                       reply)) {
+			result.forfeit = turn;
+			break;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		bool answered =
+		    engine[turn].send(12, std::string("genmove ") + ColorName(color[turn]), reply);
+		double elapsed = std::chrono::duration<double, std::milli>(
+		                     std::chrono::steady_clock::now() - start)
+		                     .count();
+		result.latency[turn].push_back(elapsed);
+		time_left[turn] -= (int)elapsed;
+
+		// 逾時、無回應或走步不合法皆判負
+		char src[8], dst[8];
+		int from = -1, to = -1, action_id = -1;
+		if (answered && sscanf(reply.c_str(), "%7s %7s", src, dst) == 2 &&
+		    strlen(src) == 2 && strlen(dst) == 2) {
+			from = string2square(src);
+			to = string2square(dst);
+			if (from >= 0 && from < BOARD_SIZE && to >= 0 && to < BOARD_SIZE) {
+				for (int i = 0; i < ACTION_SIZE; i++) {
+					if (ActionMap[i].first == from && ActionMap[i].second == to) {
+						action_id = i;
+						break;
+					}
+				}
+			}
+		}
+		if (!answered) {
+			result.forfeit = turn;
+			break;
+		}
+		if (action_id < 0 || (opt.time_ms > 0 && time_left[turn] < 0) ||
+		    !state.isLegalAction(DarkChess_Action(state.getCurrColor(), action_id))) {
+			winner = 1 - turn;
+			break;
+		}
+
+		std::string command;
+		if (from == to) {
+			FIN f = hidden.back();
+			hidden.pop_back();
+			if (color[turn] == UNKNOWN) {
+				color[turn] = color_of(f);
+				color[1 - turn] = color_of(f) == RED ? BLK : RED;
+			}
+			state.setCurrPlayer(color[turn]);
+			state.applyFlip(from, f);
+			command = "flip " + SquareName(from) + " " + finEN[f];
+		} else {
+			state.setCurrPlayer(color[turn]);
+			state.applyMoveEat(from, to);
+			command = "move " + SquareName(from) + " " + SquareName(to);
+		}
+		for (int e = 0; e < 2 && result.forfeit < 0; e++) {
+			if (!engine[e].send(from == to ? 11 : 10, command, reply)) result.forfeit = e;
+		}
+		if (result.forfeit >= 0) break;
+
+		turn = 1 - turn;
+		if (state.getAvailableActions().empty()) { // 對手無棋可走
+			winner = 1 - turn;
+			break;
+		}
+		if (state.isTerminal()) break; // 無吃翻或長捉，和局
+	}
+
+	if (result.forfeit >= 0) winner = 1 - result.forfeit;
+	if (winner != -1) result.score = winner == 0 ? 2 : 0;
+	for (int e = 0; e < 2; e++) {
+		std::string reply;
+		const char* outcome = winner == -1 ? "draw" : winner == e ? "win" : "lose";
+		engine[e].send(13, std::string("game_over ") + outcome, reply);
+	}
+	return result;
+}
+
+// 引擎命令列的搜尋線程數（--threads 乘上 --procs）
+static int EngineThreads(const std::string& command) {
+	int threads = ENGINE_DEFAULT_THREADS, procs = 1;
+	const char* s = command.c_str();
+	const char* p;
+	if ((p = strstr(s, "--threads ")) != NULL) threads = std::max(1, atoi(p + 10));
+	if ((p = strstr(s, "--procs ")) != NULL) procs = std::max(1, atoi(p + 8));
+	return threads * procs;
+}
+
+static double Percentile(std::vector<double>& v, double p) {
+	if (v.empty()) return 0;
+	std::sort(v.begin(), v.end());
+	size_t idx = std::min(v.size() - 1, (size_t)(p * (v.size() - 1) + 0.5));
+	return v[idx];
+}
+
+static double Elo(double score) {
+	score = std::min(std::max(score, 1e-3), 1 - 1e-3);
+	return -400.0 * log10(1.0 / score - 1.0);
+}
+
+int main(int argc, char* argv[]) {
+	Options opt;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-a") == 0) {
+			opt.engine[0] = argv[i + 1];
+		} else if (strcmp(argv[i], "-b") == 0) {
+			opt.engine[1] = argv[i + 1];
+		} else if (strcmp(argv[i], "-n") == 0) {
+			opt.games = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-j") == 0) {
+			opt.jobs = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-t") == 0) {
+			opt.time_ms = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-s") == 0) {
+			opt.seed = strtoul(argv[i + 1], NULL, 10);
+		} else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+	// 同一局只有一方在思考，每局約佔用一個引擎的線程數
+	int cores = std::max(1u, std::thread::hardware_concurrency());
+	int threads = std::max(EngineThreads(opt.engine[0]), EngineThreads(opt.engine[1]));
+	if (opt.jobs <= 0) {
+		opt.jobs = std::max(1, cores / threads);
+	} else if (opt.jobs * threads > cores) {
+		fprintf(stderr,
+		        "warning: %d jobs x %d search threads exceed %d cores, "
+		        "latencies will be inflated\n",
+		        opt.jobs, threads, cores);
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	std::atomic<int> next_game(0);
+	std::atomic<bool> aborted(false);
+	std::mutex mutex;
+	int wins = 0, draws = 0, losses = 0;
+	std::vector<double> latency[2];
+
+	std::vector<std::thread> workers;
+	for (int j = 0; j < opt.jobs; j++) {
+		workers.emplace_back([&]() {
+			int game;
+			while (!aborted && (game = next_game++) < opt.games) {
+				GameResult r = PlayGame(opt, game);
+				if (r.failed) {
+					aborted = true;
+					break;
+				}
+				std::lock_guard<std::mutex> lock(mutex);
+				if (r.score == 2) wins++;
+				else if (r.score == 1) draws++;
+				else losses++;
+				for (int e = 0; e < 2; e++) {
+					latency[e].insert(latency[e].end(), r.latency[e].begin(),
+					                  r.latency[e].end());
+				}
+				fprintf(stderr, "game %d: %s%s (+%d =%d -%d)\n", game + 1,
+				        r.score == 2 ? "A wins" : r.score == 1 ? "draw" : "B wins",
+				        r.forfeit >= 0 ? " by forfeit" : "", wins, draws, losses);
+			}
+		});
+	}
+	for (auto& worker : workers) worker.join();
+	if (aborted) return 1;
+
+	int n = wins + draws + losses;
+	double score = n > 0 ? (wins + 0.5 * draws) / n : 0.5;
+	double var = n > 0 ? (wins * pow(1 - score, 2) + draws * pow(0.5 - score, 2) +
+	                      losses * pow(score, 2)) / n
+	                   : 0;
+	double margin = 1.96 * sqrt(var / std::max(n, 1));
+
+	printf("A: %s\nB: %s\n", opt.engine[0].c_str(), opt.engine[1].c_str());
+	printf("games %d: A +%d =%d -%d, score %.1f%%\n", n, wins, draws, losses,
+	       score * 100);
+	printf("elo %+.1f [%+.1f, %+.1f] (95%%)\n", Elo(score), Elo(score - margin),
+	       Elo(score + margin));
+	for (int e = 0; e < 2; e++) {
+		std::vector<double>& v = latency[e];
+		printf("latency %c (ms): n %zu p50 %.1f p90 %.1f p99 %.1f max %.1f\n",
+		       "AB"[e], v.size(), Percentile(v, 0.5), Percentile(v, 0.9),
+		       Percentile(v, 0.99), Percentile(v, 1.0));
+	}
+	return 0;
+}
@@ -0,0 +1,138 @@
+/*
+ * Build an opening book for MyAI
+ *
+ * Plays self-play games from the initial position, searches every position
+ * of the first plies with deterministic MCTS and stores the root statistics
+ * in a memory-mappable book file. Mirrored positions share one canonical key
+ * (see Symmetry.h) and their actions are stored in the canonical orientation.
+ * Search output from other sources can be merged with -i, one
+ * "<hex canonical key> <canonical action id> <visits> <score>" per line.
+ *
+ * usage: book_builder [-o book.bin] [-g games] [-d plies] [-p playouts]
+ *                     [-t threads] [-s seed] [-i search_output.txt]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+#include "DarkChess.h"
+#include "MCTS.h"
+#include "OpeningBook.h"
+#include "Symmetry.h"
+
+static void SelfPlay(std::vector<BookEntry>& entries, int game, int plies,
+                     int playouts, int threads, unsigned int seed) {
+	std::seed_seq seq{seed, static_cast<unsigned int>(game)};
+	std::mt19937 rng(seq);
+
+	DarkChess_State state;
+	int mover = UNKNOWN; // 輪到的玩家，第一次翻棋後才確定
+	for (int ply = 0; ply < plies && !state.isTerminal(); ply++) {
+		if (mover != UNKNOWN) {
+			state.setMyColor(mover);
+			state.setOppColor(mover == RED ? BLK : RED);
+		}
+		std::vector<DarkChess_Action> actions = state.getAvailableActions();
+		if (actions.empty()) break;
+		dedupeSymmetricActions(state, actions);
+
+		MCTS<DarkChess_State, DarkChess_Action> mcts(state, actions);
+		mcts.simulation_count = playouts;
+		mcts.thread_count = threads;
+		mcts.deterministic = true;
+		mcts.seed = rng();
+		mcts.prune_actions = dedupeSymmetricActions;
+		DarkChess_Action best = mcts.run(rng);
+
+		int symmetry;
+		uint64_t key = canonicalHash(state, mover, symmetry);
+		for (const auto& stat : mcts.rootStats()) {
+			if (stat.second.first == 0) continue;
+			BookEntry entry;
+			memset(&entry, 0, sizeof(entry));
+			entry.key = key;
+			entry.action_id = transformAction(stat.first, symmetry);
+			entry.visits = stat.second.first;
+			entry.score = stat.second.second / stat.second.first;
+			entries.push_back(entry);
+		}
+
+		int to = ActionMap[best.getActionID()].second;
+		state = state.applyAction(best, rng);
+		if (mover == UNKNOWN) {
+			mover = color_of(state.getPiece(to)) == RED ? BLK : RED;
+		} else {
+			mover = mover == RED ? BLK : RED;
+		}
+	}
+}
+
+static bool ImportSearchOutput(std::vector<BookEntry>& entries,
+                               const char* path) {
+	FILE* fp = fopen(path, "r");
+	if (fp == NULL) return false;
+
+	unsigned long long key;
+	unsigned int action_id, visits;
+	float score;
+	while (fscanf(fp, "%llx %u %u %f", &key, &action_id, &visits, &score) == 4) {
+		if (action_id >= ACTION_SIZE) continue;
+		BookEntry entry;
+		memset(&entry, 0, sizeof(entry));
+		entry.key = key;
+		entry.action_id = action_id;
+		entry.visits = visits;
+		entry.score = score;
+		entries.push_back(entry);
+	}
+	fclose(fp);
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	const char* output = "book.bin";
+	const char* input = NULL;
+	int games = 16, plies = 4, playouts = 20000, threads = 4;
+	unsigned int seed = 1;
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-o") == 0) {
+			output = argv[i + 1];
+		} else if (strcmp(argv[i], "-g") == 0) {
+			games = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-d") == 0) {
+			plies = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-p") == 0) {
+			playouts = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-t") == 0) {
+			threads = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-s") == 0) {
+			seed = strtoul(argv[i + 1], NULL, 10);
+		} else if (strcmp(argv[i], "-i") == 0) {
+			input = argv[i + 1];
+		} else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	std::vector<BookEntry> entries;
+	if (input != NULL && !ImportSearchOutput(entries, input)) {
+		fprintf(stderr, "cannot read %s\n", input);
+		return 1;
+	}
+	for (int g = 0; g < games; g++) {
+		SelfPlay(entries, g, plies, playouts, threads, seed);
+		fprintf(stderr, "game %d/%d: %zu entries\n", g + 1, games, entries.size());
+	}
+
+	if (!OpeningBook::write(output, entries)) {
+		fprintf(stderr, "cannot write %s\n", output);
+		return 1;
+	}
+	printf("%s: %zu entries\n", output, entries.size());
+	return 0;
+}
@@ -0,0 +1,42 @@
+/*
+ * Generate retrograde endgame tablebases
+ *
+ * Solves every fully revealed material combination with up to -k pieces
+ * (both colors present) and writes one memory-mappable file per combination.
+ *
+ * usage: tb_generator [-k max_pieces] [-o dir]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "Tablebase.h"
+
+int main(int argc, char* argv[]) {
+	const char* dir = "tb";
+	int max_pieces = 3;
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-k") == 0) {
+			max_pieces = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-o") == 0) {
+			dir = argv[i + 1];
+		} else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (max_pieces < 2 || max_pieces > Tablebase::MAX_PIECES) {
+		fprintf(stderr, "max_pieces must be between 2 and %d\n",
+		        Tablebase::MAX_PIECES);
+		return 1;
+	}
+
+	mkdir(dir, 0755);
+	if (!Tablebase::generate(dir, max_pieces, stderr)) {
+		fprintf(stderr, "cannot write tablebases to %s\n", dir);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,223 @@
+/*
+ * Train the value network used in place of random playouts
+ *
+ * Samples positions from random games, labels every position with the mean
+ * result of random playouts (red's point of view), fits a float network of
+ * the same shape as ValueNet with SGD and writes the int8-quantized weights.
+ *
+ * usage: vnet_trainer [-o vnet.bin] [-n positions] [-p playouts]
+ *                     [-e epochs] [-l learning_rate] [-s seed]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "DarkChess.h"
+#include "ValueNet.h"
+
+static const int IN = ValueNet::INPUTS;
+static const int H1 = ValueNet::HIDDEN1;
+static const int H2 = ValueNet::HIDDEN2;
+
+// 與量化後可表示的範圍一致
+static const float W1_LIMIT = 8.0f;
+static const float W_LIMIT = 127.0f / ValueNet::QB;
+
+struct Sample {
+	std::vector<ValueNet::Feature> features;
+	float target;
+	DarkChess_State state;
+};
+
+struct Network {
+	std::vector<float> w1, b1, w2, b2, w3;
+	float b3 = 0;
+
+	explicit Network(std::mt19937& rng)
+	    : w1(IN * H1), b1(H1, 0.5f), w2(H2 * H1), b2(H2, 0.1f), w3(H2) {
+		std::uniform_real_distribution<float> d1(-0.1f, 0.1f);
+		std::uniform_real_distribution<float> d2(-0.25f, 0.25f);
+		for (float& w : w1) w = d1(rng);
+		for (float& w : w2) w = d2(rng);
+		for (float& w : w3) w = d2(rng);
+	}
+
+	float forward(const std::vector<ValueNet::Feature>& x, float* z1, float* a1,
+	              float* z2, float* a2) const {
+		for (int j = 0; j < H1; j++) z1[j] = b1[j];
+		for (const auto& f : x) {
+			const float* row = &w1[f.index * H1];
+			for (int j = 0; j < H1; j++) z1[j] += f.value * row[j];
+		}
+		for (int j = 0; j < H1; j++) a1[j] = std::min(1.0f, std::max(0.0f, z1[j]));
+		float y = b3;
+		for (int i = 0; i < H2; i++) {
+			z2[i] = b2[i];
+			for (int j = 0; j < H1; j++) z2[i] += w2[i * H1 + j] * a1[j];
+			a2[i] = std::min(1.0f, std::max(0.0f, z2[i]));
+			y += w3[i] * a2[i];
+		}
+		return tanhf(y);
+	}
+
+	// 單一樣本的 SGD，回傳平方誤差
+	float train(const Sample& s, float lr) {
+		float z1[H1], a1[H1], z2[H2], a2[H2];
+		float y = forward(s.features, z1, a1, z2, a2);
+		float err = y - s.target;
+		float dy = 2 * err * (1 - y * y);
+
+		float da1[H1] = {0};
+		for (int i = 0; i < H2; i++) {
+			float dz2 = (z2[i] > 0 && z2[i] < 1) ? dy * w3[i] : 0;
+			w3[i] = std::min(W_LIMIT, std::max(-W_LIMIT, w3[i] - lr * dy * a2[i]));
+			if (dz2 == 0) continue;
+			for (int j = 0; j < H1; j++) {
+				float& w = w2[i * H1 + j];
+				da1[j] += dz2 * w;
+				w = std::min(W_LIMIT, std::max(-W_LIMIT, w - lr * dz2 * a1[j]));
+			}
+			b2[i] -= lr * dz2;
+		}
+		b3 -= lr * dy;
+
+		for (int j = 0; j < H1; j++) {
+			float dz1 = (z1[j] > 0 && z1[j] < 1) ? da1[j] : 0;
+			if (dz1 == 0) continue;
+			for (const auto& f : s.features) {
+				float& w = w1[f.index * H1 + j];
+				w = std::min(W1_LIMIT, std::max(-W1_LIMIT, w - lr * dz1 * f.value));
+			}
+			b1[j] -= lr * dz1;
+		}
+		return err * err;
+	}
+};
+
+// 隨機對局到隨機的步數，以隨機模擬的平均結果為標籤
+static Sample MakeSample(int index, int playouts, unsigned int seed) {
+	std::seed_seq seq{seed, static_cast<unsigned int>(index)};
+	std::mt19937 rng(seq);
+
+	DarkChess_State state;
+	// 至少走一步：第一次翻子前還沒有顏色，翻子時 my_color 會被改為翻子方，
+	// 結果就不是以紅方為視角
+	int plies = std::uniform_int_distribution<>(1, 120)(rng);
+	for (int ply = 0; ply < plies && !state.isTerminal(); ply++) {
+		std::vector<DarkChess_Action> actions = state.getAvailableActions();
+		if (actions.empty()) break;
+		state = state.applyAction(
+		    actions[std::uniform_int_distribution<>(0, actions.size() - 1)(rng)], rng);
+	}
+	state.setMyColor(RED);
+	state.setOppColor(BLK);
+
+	double sum = 0;
+	for (int p = 0; p < playouts; p++) {
+		DarkChess_State s = state;
+		while (!s.isTerminal()) {
+			std::vector<DarkChess_Action> actions = s.getAvailableActions();
+			s = s.applyAction(
+			    actions[std::uniform_int_distribution<>(0, actions.size() - 1)(rng)], rng);
+		}
+		sum += s.getResult();
+	}
+
+	Sample sample;
+	ValueNet::Feature features[BOARD_SIZE + 16];
+	int n = ValueNet::features(state, features);
+	sample.features.assign(features, features + n);
+	sample.target = sum / playouts;
+	sample.state = state;
+	return sample;
+}
+
+int main(int argc, char* argv[]) {
+	const char* output = "vnet.bin";
+	int positions = 20000;
+	int playouts = 16;
+	int epochs = 6;
+	float lr = 0.01f;
+	unsigned int seed = 1;
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-o") == 0) {
+			output = argv[i + 1];
+		} else if (strcmp(argv[i], "-n") == 0) {
+			positions = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-p") == 0) {
+			playouts = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-e") == 0) {
+			epochs = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-l") == 0) {
+			lr = atof(argv[i + 1]);
+		} else if (strcmp(argv[i], "-s") == 0) {
+			seed = strtoul(argv[i + 1], NULL, 10);
+		} else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (positions < 10 || playouts < 1) {
+		fprintf(stderr, "need at least 10 positions and 1 playout\n");
+		return 1;
+	}
+
+	fprintf(stderr, "sampling %d positions x %d playouts\n", positions, playouts);
+	std::vector<Sample> samples(positions);
+	#pragma omp parallel for schedule(dynamic, 64)
+	for (int i = 0; i < positions; i++) {
+		samples[i] = MakeSample(i, playouts, seed);
+	}
+
+	// 最後 10% 作為驗證集
+	int train_count = positions - positions / 10;
+	std::mt19937 rng(seed);
+	Network net(rng);
+	std::vector<int> order(train_count);
+	for (int i = 0; i < train_count; i++) order[i] = i;
+
+	float z1[H1], a1[H1], z2[H2], a2[H2];
+	for (int epoch = 0; epoch < epochs; epoch++) {
+		std::shuffle(order.begin(), order.end(), rng);
+		double loss = 0;
+		for (int i : order) loss += net.train(samples[i], lr);
+
+		double val = 0;
+		for (int i = train_count; i < positions; i++) {
+			float y = net.forward(samples[i].features, z1, a1, z2, a2);
+			val += (y - samples[i].target) * (y - samples[i].target);
+		}
+		fprintf(stderr, "epoch %d: train mse %.4f, validation mse %.4f\n", epoch + 1,
+		        loss / train_count, val / (positions - train_count));
+	}
+
+	ValueNet quantized;
+	quantized.quantize(net.w1.data(), net.b1.data(), net.w2.data(), net.b2.data(),
+	                   net.w3.data(), net.b3);
+
+	// 量化誤差
+	double float_mse = 0, quant_mse = 0, diff = 0;
+	for (int i = train_count; i < positions; i++) {
+		float y = net.forward(samples[i].features, z1, a1, z2, a2);
+		float q = quantized.evaluate(samples[i].state);
+		float_mse += (y - samples[i].target) * (y - samples[i].target);
+		quant_mse += (q - samples[i].target) * (q - samples[i].target);
+		diff = std::max(diff, (double)fabsf(y - q));
+	}
+	int val_count = positions - train_count;
+	fprintf(stderr, "validation mse: float %.4f, int8 %.4f, max |float - int8| %.4f\n",
+	        float_mse / val_count, quant_mse / val_count, diff);
+
+	if (!quantized.save(output)) {
+		fprintf(stderr, "cannot write %s\n", output);
+		return 1;
+	}
+	fprintf(stderr, "wrote %s\n", output);
+	return 0;
+}